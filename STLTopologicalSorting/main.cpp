@@ -8,8 +8,15 @@
 
 #include <iostream>
 #include <cassert>
+#include <thread>
+#include <mutex>
+#include <cctype>
+#include <memory_resource>
 
 #include "stl_topological_sorter.hpp"
+#if SNICHOLLS_TOPOLOGICAL_EPOLL
+#include <unistd.h>
+#endif
 #include "third_party/cxx-prettyprint/prettyprint.hpp"
 
 template <typename S>
@@ -18,6 +25,12 @@ void print_stack( S&& s )
     snicholls::stack_helper( s, []( auto key ){ std::cout << key << std::endl; } );
 }
 
+std::string lower( std::string s )
+{
+    for ( auto& c : s ) c = static_cast<char>( std::tolower( static_cast<unsigned char>(c) ) );
+    return s;
+}
+
 void BasicStackExample()
 {
     snicholls::topological_sorter<std::string> g;
@@ -34,6 +47,17 @@ void BasicStackExample()
     
     // F E A C D B
     print_stack(s);
+    
+    // Interned - each string is stored once and the graph is built over 32 bit handles, visited in the order first mentioned
+    snicholls::topological_sorter<std::string, snicholls::interned_sorter_traits> g2;
+    g2.precede("E", "A");
+    g2.precede("F", "A");
+    g2.precede("A", "B");
+    
+    auto s2 = g2.topological_sort();
+    
+    // F E A B
+    print_stack(s2);
 }
 
 void STLMapExample()
@@ -67,6 +91,25 @@ void STLMapExample()
     std::cout << v << std::endl;
     
     assert( g.size() == v.size() );
+    
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+    assert( g.sort( std::execution::par_unseq ) == v );
+#endif
+    
+    // The topological order is cached - changing only the values reuses it, just the copy into the result is redone
+    g["A"] = 10;
+    assert( g.sort()[2].second == 10 );
+    
+    // The DAG may mention keys that are not in the container - they are left out, by either sort
+    g.precede("W", "F");
+    assert( g.sort().size() == g.size() );
+    
+    // Consuming sort
+    [[maybe_unused]] auto n = g.size();
+    auto v2 = std::move(g).sort();
+    // [(F, 5), (E, 4), (A, 0), (C, 2), (D, 3), (B, 1), (X, 100), (Y, 101), (Z, 102)]
+    std::cout << v2 << std::endl;
+    assert( g.empty() && v2.size() == n );
 }
 
 void STLUnorderedMapExample()
@@ -96,10 +139,128 @@ void STLUnorderedMapExample()
     
     auto v = g.sort();
     
-    // [(Z, 102), (F, 5), (E, 4), (A, 0), (C, 2), (D, 3), (B, 1), (X, 100), (Y, 101)]
+    // [(Z, 102), (E, 4), (F, 5), (A, 0), (C, 2), (D, 3), (B, 1), (Y, 101), (X, 100)]
     std::cout << v << std::endl;
     
     assert( g.size() == v.size() );
+    
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+    assert( g.sort( std::execution::par_unseq ) == v );
+#endif
+    
+    // Consuming sort - the values are moved out of the container rather than copied
+    [[maybe_unused]] auto n = g.size();
+    auto v2 = std::move(g).sort();
+    // [(Z, 102), (E, 4), (F, 5), (A, 0), (C, 2), (D, 3), (B, 1), (Y, 101), (X, 100)]
+    std::cout << v2 << std::endl;
+    assert( g.empty() && v2.size() == n );
+    
+    // Stateful Hash and KeyEqual - the DAG uses the very instances the container was built with, so "b" and "B" are one key in both
+    struct CaseHash
+    {
+        bool fold{ false };
+        std::size_t operator()( const std::string& s ) const { return std::hash<std::string>{}( fold ? lower(s) : s ); }
+    };
+    struct CaseEqual
+    {
+        bool fold{ false };
+        bool operator()( const std::string& a, const std::string& b ) const { return fold ? lower(a) == lower(b) : a == b; }
+    };
+    
+    snicholls::topological_sort_unordered_map<std::string, int, CaseHash, CaseEqual> g2( std::size_t{16}, CaseHash{ true }, CaseEqual{ true } );
+    g2.precede("b", "A");
+    g2["A"] = 1;
+    g2["B"] = 2;
+    
+    auto v3 = g2.sort();
+    // [(B, 2), (A, 1)]
+    std::cout << v3 << std::endl;
+    assert( v3.front().first == "B" );
+    
+    // A stateful allocator - the DAG allocates from the same resource as the container
+    struct counting_resource : std::pmr::memory_resource
+    {
+        std::size_t bytes{ 0 };
+        void* do_allocate( std::size_t n, std::size_t align ) override
+        {
+            bytes += n;
+            return std::pmr::new_delete_resource()->allocate( n, align );
+        }
+        void do_deallocate( void* p, std::size_t n, std::size_t align ) override { std::pmr::new_delete_resource()->deallocate( p, n, align ); }
+        bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override { return this == &other; }
+    } arena;
+    
+    using pmr_allocator = std::pmr::polymorphic_allocator< std::pair<const std::string, int> >;
+    snicholls::topological_sort_unordered_map<std::string, int, std::hash<std::string>, std::equal_to<std::string>, pmr_allocator> g3{ pmr_allocator( &arena ) };
+    g3.precede("F", "C");
+    g3.precede("E", "A");
+    assert( arena.bytes > 0 && g3.empty() );
+}
+
+void FlatMapExample()
+{
+    snicholls::topological_sort_flat_map<std::string, int> g{ { "A", 0 }, { "B", 1 }, { "C", 2 }, { "D", 3 }, { "E", 4 }, { "F", 5 } };
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    g["X"] = 100;
+    g["Y"] = 101;
+    g["Z"] = 102;
+    
+    auto v = g.sort();
+    
+    // [F, E, A, C, D, B, X, Y, Z] [5, 4, 0, 2, 3, 1, 100, 101, 102]
+    std::cout << v.keys << " " << v.values << std::endl;
+    assert( g.size() == v.keys.size() && g.size() == v.values.size() );
+    assert( g.at("F") == 5 && v.values.front() == 5 );
+    
+    // Consuming sort - the two containers are permuted in place and handed over
+    auto v2 = std::move(g).sort();
+    assert( v2.keys == v.keys && v2.values == v.values && g.empty() );
+}
+
+void STLMultimapExample()
+{
+    snicholls::topological_sort_multimap<std::string, int> g;
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    g.insert( { { "A", 0 }, { "B", 1 }, { "A", 2 }, { "X", 3 }, { "F", 4 }, { "C", 5 }, { "D", 6 }, { "E", 7 }, { "F", 8 } } );
+    
+    auto v = g.sort();
+    
+    // [(F, 4), (F, 8), (E, 7), (A, 0), (A, 2), (C, 5), (D, 6), (B, 1), (X, 3)]
+    std::cout << v << std::endl;
+    assert( g.size() == v.size() );
+    
+    auto v2 = std::move(g).sort();
+    assert( v2 == v && g.empty() );
+    
+    snicholls::topological_sort_multiset<std::string> g2{ "A", "B", "A", "X", "F", "C", "D", "E", "F" };
+    g2.precede("F", "C");
+    g2.precede("F", "A");
+    g2.precede("E", "A");
+    g2.precede("E", "B");
+    g2.precede("C", "D");
+    g2.precede("D", "B");
+    
+    auto v3 = g2.sort();
+    
+    // [F, F, E, A, A, C, D, B, X]
+    std::cout << v3 << std::endl;
+    assert( g2.size() == v3.size() );
 }
 
 void STLVectorExample()
@@ -132,11 +293,11 @@ void STLVectorExample()
     // Now push back Z
     g.push_back("Z");
     auto v2 = g.sort();
-    // [Z, F, F, F, E, E, C, C, D, D, B, B, A, A, A]
+    // [Z, F, F, F, E, E, A, A, A, C, C, D, D, B, B]
     std::cout << v2 << std::endl;
     assert( g.size() == v2.size() );
     
-    // Example 2
+    // Example 2 - integral keys are direct indexed, the DAG is kept in plain arrays indexed by key
     snicholls::topological_sort_vector<int> g3{0,1,2,3,4,5,6,7,8,9};
     g3.precede( 9, 0 );
     g3.precede( 8, 1 );
@@ -148,6 +309,600 @@ void STLVectorExample()
     // [9, 0, 8, 1, 7, 2, 6, 3, 5, 4]
     std::cout << v3 << std::endl;
     assert( g3.size() == v3.size() );
+    
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+    // Same result - the lookups and the copy run in parallel
+    auto v4 = g3.sort( std::execution::par_unseq );
+    assert( v4 == v3 );
+    assert( g.sort( std::execution::par ) == v2 );
+#endif
+    
+    // Example 3 - std::vector<bool> hands out proxies, not references
+    snicholls::topological_sort_vector<bool> g5{true, false};
+    g5.precede( true, false );
+    
+    auto v5 = g5.sort();
+    // [1, 0]
+    std::cout << v5 << std::endl;
+    assert( v5.size() == 2 && v5[0] && !v5[1] );
+    
+    // Example 4 - the adapters take sorter traits too, here the DAG is over interned handles
+    snicholls::topological_sort_vector<std::string, std::allocator<std::string>, snicholls::interned_sorter_traits> g6{"B", "A", "C", "A"};
+    g6.precede("C", "A");
+    g6.precede("A", "B");
+    
+    auto v6 = g6.sort();
+    // [C, A, A, B]
+    std::cout << v6 << std::endl;
+    assert( g6.size() == v6.size() );
+}
+
+void STLKeyedVectorExample()
+{
+    struct Task
+    {
+        std::string name;
+        int         cost;
+    };
+    
+    snicholls::topological_sort_keyed_vector<std::string, Task> g;
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    g.push_back( { "A", 0 } );   g.push_back( { "B", 1 } );   g.push_back( { "A", 2 } );
+    g.push_back( { "X", 3 } );   g.push_back( { "F", 4 } );   g.push_back( { "C", 5 } );
+    g.push_back( { "D", 6 } );   g.push_back( { "E", 7 } );   g.push_back( { "F", 8 } );
+    
+    auto v = g.sort( &Task::name );
+    
+    // F:4 F:8 E:7 A:0 A:2 C:5 D:6 B:1 X:3 - equal keys keep their original order
+    for (const auto& task : v ) std::cout << task.name << ":" << task.cost << " ";
+    std::cout << std::endl;
+    assert( g.size() == v.size() );
+    assert( v[0].cost == 4 && v[1].cost == 8 && v[3].cost == 0 && v[4].cost == 2 );
+    
+    // Any callable will do
+    auto v2 = g.sort( []( const Task& task ) { return task.name; } );
+    assert( g.size() == v2.size() );
+}
+
+void PermutationExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    // Structure of arrays - the keys are one column of many
+    std::vector<std::string> name{ "A", "B", "C", "D", "E", "F", "X" };
+    std::vector<int>         cost{  0,   1,   2,   3,   4,   5,   100 };
+    std::vector<double>      load{  0.0, 0.1, 0.2, 0.3, 0.4, 0.5, 10.0 };
+    
+    auto perm = g.permutation( name );
+    
+    // [5, 4, 0, 2, 3, 1, 6]
+    std::cout << perm << std::endl;
+    
+    snicholls::apply_permutation( perm, name, cost, load );
+    
+    // [F, E, A, C, D, B, X] [5, 4, 0, 2, 3, 1, 100]
+    std::cout << name << " " << cost << std::endl;
+    assert( name.front() == "F" && cost.front() == 5 && load.front() == 0.5 );
+    assert( name.back() == "X" && cost.back() == 100 && load.back() == 10.0 );
+}
+
+void FreezeExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    // Sort once - the snapshot is read only, so it can be shared between threads and sorted against many times
+    const auto frozen = g.freeze();
+    
+    // [F, E, A, C, D, B]
+    std::cout << frozen.order() << std::endl;
+    assert( frozen.size() == 6 && frozen.edges() == 6 );
+    assert( frozen.rank("F") < frozen.rank("C") && frozen.rank("D") < frozen.rank("B") );
+    assert( frozen.id("X") == frozen.npos );
+    
+    // Successors of an id are a contiguous run of higher ids
+    for ( [[maybe_unused]] auto w : frozen.successors( frozen.id("F") ) )
+        assert( w > frozen.id("F") );
+    
+    std::vector<std::string> name{ "A", "B", "C", "D", "E", "F", "X" };
+    assert( frozen.permutation( name ) == g.permutation( name ) );
+    
+    // Interned - the snapshot holds the 32 bit handles and shares the sorter's pool, the strings are not copied
+    snicholls::topological_sorter<std::string, snicholls::interned_sorter_traits> g2;
+    g2.precede("F", "C");
+    g2.precede("C", "D");
+    
+    const auto frozen2 = g2.freeze();
+    
+    // [F, C, D]
+    std::cout << frozen2.order() << std::endl;
+    static_assert( std::is_same_v< decltype(frozen2)::vertex_type, std::uint32_t > );
+    assert( frozen2.rank("F") < frozen2.rank("D") && frozen2.id("X") == frozen2.npos );
+    
+    // A key new to the pool while the snapshot holds it goes into a copy - the snapshot is unchanged
+    g2.precede("D", "X");
+    assert( frozen2.size() == 3 && g2.freeze().size() == 4 );
+}
+
+void ReadySetExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    // Hand out work as it becomes runnable - here the "workers" finish everything handed to them in one round
+    g.prepare();
+    std::vector< std::vector<std::string> > rounds;
+    while ( g.is_active() )
+    {
+        auto ready = g.get_ready();
+        for ( const auto& key : ready ) g.done( key );
+        rounds.push_back( ready );
+    }
+    
+    // [[F, E], [C, A], [D], [B]]
+    std::cout << rounds << std::endl;
+    assert( rounds.size() == 4 && rounds.front().size() == 2 && rounds.back().front() == "B" );
+}
+
+void FailureExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // A small pipeline - fetch, then build and docs, then test and package, then release
+    g.precede("fetch", "build");
+    g.precede("fetch", "docs");
+    g.precede("build", "test");
+    g.precede("build", "package");
+    g.precede("test", "release");
+    g.precede("package", "release");
+    g.precede("docs", "release");
+    
+    // Everything a broken build would take with it
+    auto downstream = g.descendants("build");
+    assert( downstream.size() == 3 && downstream.back() == "release" );
+    
+    g.prepare();
+    std::vector<std::string> ran, cancelled;
+    while ( g.is_active() )
+    {
+        for ( const auto& key : g.get_ready() )
+        {
+            // The build fails - its dependants are dropped from the schedule, the docs still run
+            if ( key == "build" )
+            {
+                cancelled = g.fail( key );
+                continue;
+            }
+            ran.push_back( key );
+            g.done( key );
+        }
+    }
+    
+    // [fetch, docs] ran, [package, test, release] cancelled
+    std::cout << ran << " ran, " << cancelled << " cancelled" << std::endl;
+    assert( ran == std::vector<std::string>({ "fetch", "docs" }) );
+    assert( cancelled.size() == 3 && cancelled.back() == "release" );
+    
+    // Cancelled before it was ready - it stays cancelled when its predecessor finishes
+    g.prepare();
+    auto first = g.get_ready();
+    assert( first == std::vector<std::string>({ "fetch" }) );
+    cancelled = g.fail("docs");
+    assert( cancelled == std::vector<std::string>({ "release" }) );
+    g.done("fetch");
+    auto second = g.get_ready();
+    assert( second == std::vector<std::string>({ "build" }) );
+    g.done("build");
+    auto ready = g.get_ready();
+    assert( ready.size() == 2 && std::find( ready.begin(), ready.end(), "docs" ) == ready.end() );
+    for ( const auto& key : ready ) g.done( key );
+    assert( g.get_ready().empty() && !g.is_active() );
+}
+
+void AffectedOrderExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // Sources compile to objects, objects link into binaries
+    g.precede("util.cpp", "util.o");
+    g.precede("main.cpp", "main.o");
+    g.precede("test.cpp", "test.o");
+    g.precede("util.o", "app");
+    g.precede("main.o", "app");
+    g.precede("util.o", "tests");
+    g.precede("test.o", "tests");
+    
+    // Only what depends on the edited files is rebuilt, in build order
+    auto rebuild = g.affected_order({ "main.cpp" });
+    
+    // [main.cpp, main.o, app]
+    std::cout << rebuild << std::endl;
+    assert( rebuild == std::vector<std::string>({ "main.cpp", "main.o", "app" }) );
+    
+    // Overlapping changes are only rebuilt once, unknown keys are ignored
+    rebuild = g.affected_order( std::vector<std::string>{ "util.cpp", "test.o", "README" } );
+    assert( rebuild.size() == 5 && std::find( rebuild.begin(), rebuild.end(), "main.o" ) == rebuild.end() );
+    [[maybe_unused]] const auto& dag = g.frozen();
+    for ( std::size_t i{1}; i < rebuild.size(); ++i )
+        assert( dag.rank( rebuild[i - 1] ) < dag.rank( rebuild[i] ) );
+}
+
+void ConcurrentReadySetExample()
+{
+    snicholls::topological_sorter<int> g;
+    
+    // Two chains joined at the end - 0 1 2 3 and 10 11 12 13 then 100
+    for ( int i : { 0, 1, 2, 10, 11, 12 } ) g.precede( i, i + 1 );
+    g.precede( 3, 100 );
+    g.precede( 13, 100 );
+    
+    // Each worker takes what is ready, runs it and marks it done - no locks anywhere
+    const unsigned workers = 2;
+    auto ready = g.prepare_concurrent( workers );
+    std::vector< std::atomic<int> > finished_at( 101 );
+    std::atomic<int> clock{0};
+    
+    std::vector< std::thread > pool;
+    for ( unsigned w{0}; w < workers; ++w )
+        pool.emplace_back( [&, w] {
+            while ( ready.is_active() )
+            {
+                if ( auto v = ready.try_get( w ) )
+                {
+                    finished_at[ ready.dag().key( *v ) ] = ++clock;
+                    ready.done_id( *v, w );
+                }
+                else std::this_thread::yield();
+            }
+        } );
+    for ( auto& t : pool ) t.join();
+    
+    assert( clock == 9 );
+    assert( finished_at[3] < finished_at[100] && finished_at[13] < finished_at[100] );
+    assert( finished_at[0] < finished_at[1] && finished_at[10] < finished_at[13] );
+    
+    // A key the DAG does not have is refused, not looked up
+    [[maybe_unused]] auto refused = []( auto&& call ) {
+        try { call(); } catch ( const std::invalid_argument& ) { return true; }
+        return false;
+    };
+    assert( refused( [&] { ready.done( 42, 0 ); } ) );
+    
+    // So is a vertex already done, or already failed - the work left is not counted down twice and the workers still stop
+    assert( refused( [&] { ready.done( 100, 0 ); } ) && refused( [&] { ready.fail( 100 ); } ) );
+    assert( !ready.is_active() );
+    
+    auto again = g.prepare_concurrent( workers );
+    const auto first = again.try_get( 0 ).value();
+    const auto downstream = again.fail_id( first );
+    assert( downstream.size() == 4 );
+    assert( refused( [&] { again.fail_id( first ); } ) && refused( [&] { again.done_id( first, 0 ); } ) );
+    assert( again.is_active() );
+}
+
+void ExecutorExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // A small build - compile both, then link, then test
+    g.precede("compile a", "link");
+    g.precede("compile b", "link");
+    g.precede("link", "test");
+    
+    std::mutex m;
+    std::vector<std::string> log;
+    auto step = [&](const std::string& what) { return [&, what] { std::lock_guard lock(m); log.push_back( what ); }; };
+    
+    // Key -> callable - each runs as soon as everything it depends on has finished
+    std::map< std::string, std::function<void()> > work{
+        { "compile a", step("a.o") }, { "compile b", step("b.o") }, { "link", step("app") }, { "test", step("ok") } };
+    
+    snicholls::topological_executor pool( 2 );
+    pool.run( g, work );
+    
+    // eg [b.o, a.o, app, ok]
+    std::cout << log << std::endl;
+    assert( log.size() == 4 && log[2] == "app" && log[3] == "ok" );
+}
+
+#if SNICHOLLS_TOPOLOGICAL_COROUTINES
+void AsyncExecutorExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // Fetch and parse two inputs, then merge them
+    g.precede("fetch a", "parse a");
+    g.precede("fetch b", "parse b");
+    g.precede("parse a", "merge");
+    g.precede("parse b", "merge");
+    
+    snicholls::topological_async_executor ex( 2 );
+    std::mutex m;
+    std::vector<std::string> log;
+    
+#if SNICHOLLS_TOPOLOGICAL_EPOLL
+    // "fetch b" waits on a pipe without holding a thread - "fetch a" fills it
+    int pipe_fds[2];
+    [[maybe_unused]] auto ok = ::pipe( pipe_fds );
+    assert( ok == 0 );
+#endif
+    
+    ex.run( g, [&](const std::string& key) -> snicholls::topological_task {
+#if SNICHOLLS_TOPOLOGICAL_EPOLL
+        if ( key == "fetch a" )
+        {
+            char c{'x'};
+            [[maybe_unused]] auto n = ::write( pipe_fds[1], &c, 1 );
+        }
+        if ( key == "fetch b" )
+        {
+            co_await ex.readable( pipe_fds[0] );
+            char c;
+            [[maybe_unused]] auto n = ::read( pipe_fds[0], &c, 1 );
+        }
+#endif
+        co_await ex.schedule();
+        std::lock_guard lock(m);
+        log.push_back( key );
+    } );
+    
+#if SNICHOLLS_TOPOLOGICAL_EPOLL
+    ::close( pipe_fds[0] );
+    ::close( pipe_fds[1] );
+#endif
+    
+    // eg [fetch a, parse a, fetch b, parse b, merge]
+    std::cout << log << std::endl;
+    assert( log.size() == 5 && log.back() == "merge" );
+}
+#endif
+
+void ListScheduleExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    // Estimated cost of each job
+    std::map<std::string, double> cost{ {"A", 2}, {"B", 1}, {"C", 3}, {"D", 3}, {"E", 1}, {"F", 2} };
+    
+    // Two workers - the critical path F C D B goes first
+    auto schedule = g.list_schedule( 2, [&](const std::string& key) { return cost.at(key); } );
+    const auto& dag = g.frozen();
+    
+    for ( auto v : schedule.sequence )
+        std::cout << dag.key(v) << " on " << schedule.worker[v] << " at " << schedule.start[v] << std::endl;
+    
+    // F C D B takes 9 and nothing else need wait
+    assert( schedule.makespan == 9 );
+    assert( dag.key( schedule.sequence.front() ) == "F" );
+}
+
+void CriticalPathExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // Durations on the vertices, a lag on one edge
+    g.precede("design", "build");
+    g.precede("design", "docs");
+    g.precede("build", "ship", 1.0);
+    g.precede("docs", "ship");
+    g.weigh("design", 2);
+    g.weigh("build", 5);
+    g.weigh("docs", 3);
+    g.weigh("ship", 1);
+    
+    // [design, build, ship] - 2 + 5 + 1 + 1
+    auto path = g.critical_path();
+    std::cout << path << std::endl;
+    assert( ( path == std::vector<std::string>{ "design", "build", "ship" } ) );
+    
+    [[maybe_unused]] const auto& dag = g.frozen();
+    assert( dag.longest_paths()[ dag.id("ship") ] == 9 );
+    assert( ( g.shortest_path( "design", "ship" ) == std::vector<std::string>{ "design", "docs", "ship" } ) );
+    
+    // A weighed key with no constraints is a vertex of its own - here the longest job of all
+    g.weigh("audit", 100);
+    assert( ( g.critical_path() == std::vector<std::string>{ "audit" } ) );
+}
+
+void FoldExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    // Number of paths from each source - start each source at 1 and add up the predecessors
+    const auto& dag = g.frozen();
+    auto init = [&](const std::string& key) { return dag.in_degree( dag.id(key) ) == 0 ? 1 : 0; };
+    auto paths = g.fold( init, std::plus<>{} );
+    
+    // A is reached from E and from F, B from E and along F C D
+    assert( paths[ dag.id("A") ] == 2 );
+    assert( paths[ dag.id("B") ] == 2 );
+    assert( paths[ dag.id("D") ] == 1 );
+    
+    // More threads only help on wide levels - a DAG this small is swept on the calling thread whatever we ask for
+    assert( g.fold( init, std::plus<>{}, 4 ) == paths );
+}
+
+void PertExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // Maintenance jobs and their durations in hours
+    g.precede("drain", "patch");
+    g.precede("drain", "backup");
+    g.precede("patch", "restart");
+    g.precede("backup", "restart");
+    std::map<std::string, double> hours{ {"drain", 1}, {"patch", 4}, {"backup", 2}, {"restart", 1} };
+    
+    auto plan = g.pert( [&](const std::string& key) { return hours.at(key); } );
+    const auto& dag = g.frozen();
+    
+    for ( const auto& key : dag.order() )
+    {
+        auto v = dag.id(key);
+        std::cout << key << " earliest " << plan.earliest_start[v] << " latest " << plan.latest_start[v] << " slack " << plan.slack[v] << std::endl;
+    }
+    
+    // The backup can slip by 2 hours without delaying the restart
+    assert( plan.makespan == 6 );
+    assert( plan.slack[ dag.id("backup") ] == 2 && plan.slack[ dag.id("patch") ] == 0 );
+}
+
+void STLListExample()
+{
+    snicholls::topological_sort_list<std::string> g{ "A", "B", "X", "C", "D", "A", "E", "F" };
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    // Iterators survive the sort - the nodes are relinked, never copied
+    [[maybe_unused]] auto x = std::find( g.begin(), g.end(), "X" );
+    [[maybe_unused]] auto n = g.size();
+    
+    g.sort();
+    
+    // [F, E, A, A, C, D, B, X]
+    std::cout << g << std::endl;
+    assert( g.size() == n );
+    assert( *x == "X" && std::next(x) == g.end() );
+}
+
+void STLDequeExample()
+{
+    snicholls::topological_sort_deque<int> g{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
+    g.precede( 9, 0 );
+    g.precede( 8, 1 );
+    g.precede( 7, 2 );
+    g.precede( 6, 3 );
+    g.precede( 5, 4 );
+    
+    g.sort();
+    
+    // [9, 0, 0, 8, 1, 7, 2, 6, 3, 5, 4]
+    std::cout << g << std::endl;
+    assert( g.size() == 11 && g[0] == 9 && g[1] == 0 && g[2] == 0 );
+}
+
+void SpanExample()
+{
+    // Memory we do not own
+    std::string buffer[] = { "A", "B", "C", "D", "E", "F", "X", "Y", "Z" };
+    
+    snicholls::topological_sort_span<std::string> g{ buffer };
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    g.sort();
+    
+    // [F, E, A, C, D, B, X, Y, Z]
+    std::cout << g << std::endl;
+    assert( buffer[0] == "F" && buffer[8] == "Z" );
+}
+
+void TopologicalViewExample()
+{
+    snicholls::topological_sorter<std::string> g;
+    
+    // F before C, E before A etc
+    g.precede("F", "C");
+    g.precede("F", "A");
+    g.precede("E", "A");
+    g.precede("E", "B");
+    g.precede("C", "D");
+    g.precede("D", "B");
+    
+    // Any forward range - nothing to inherit from and nothing is copied
+    const std::vector<std::string> names{ "A", "B", "C", "D", "E", "F", "X", "Y", "Z" };
+    
+    // F E A C D B X Y Z
+    for ( const auto& name : names | snicholls::views::topological( g ) )
+        std::cout << name << " ";
+    std::cout << std::endl;
+    
+    // Stop early - only pay for what we consume
+    auto first = names | snicholls::views::topological( g ) | std::views::take( 3 );
+    
+    // F E A
+    for ( const auto& name : first )
+        std::cout << name << " ";
+    std::cout << std::endl;
+    assert( *first.begin() == "F" );
+    
+    // Views whose elements are prvalues - iota, transform - work just as well
+    snicholls::topological_sorter<int> g2;
+    g2.precede( 6, 0 );
+    g2.precede( 5, 1 );
+    g2.precede( 4, 2 );
+    
+    // 6 0 5 1 4 2 3
+    for ( int i : std::views::iota( 0, 7 ) | snicholls::views::topological( g2 ) )
+        std::cout << i << " ";
+    std::cout << std::endl;
+    
+    // Projected through a transform - the element is a std::pair made on the fly
+    auto pairs = std::views::iota( 0, 7 ) | std::views::transform( []( int i ) { return std::pair{ i, i * i }; } );
+    
+    // 6:36 0:0 5:25 1:1 4:16 2:4 3:9
+    for ( const auto& [i, square] : pairs | snicholls::views::topological( g2, &std::pair<int, int>::first ) )
+        std::cout << i << ":" << square << " ";
+    std::cout << std::endl;
+    assert( std::ranges::distance( std::views::iota( 0, 7 ) | snicholls::views::topological( g2 ) ) == 7 );
 }
 
 void STLArrayExample()
@@ -167,6 +922,10 @@ void STLArrayExample()
     // [F, E, A, C, D, B, X, Y, Z]
     std::cout << v << std::endl;
     assert( g.size() == v.size() );
+    
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+    assert( g.sort( std::execution::par_unseq ) == v );
+#endif
 }
 
 int main(int argc, const char * argv[]) {
@@ -174,7 +933,28 @@ int main(int argc, const char * argv[]) {
     BasicStackExample();
     STLMapExample();
     STLUnorderedMapExample();
+    FlatMapExample();
+    STLMultimapExample();
     STLVectorExample();
+    STLKeyedVectorExample();
+    PermutationExample();
+    FreezeExample();
+    ReadySetExample();
+    FailureExample();
+    AffectedOrderExample();
+    ListScheduleExample();
+    CriticalPathExample();
+    PertExample();
+    FoldExample();
+    ConcurrentReadySetExample();
+    ExecutorExample();
+#if SNICHOLLS_TOPOLOGICAL_COROUTINES
+    AsyncExecutorExample();
+#endif
+    STLListExample();
+    STLDequeExample();
+    SpanExample();
+    TopologicalViewExample();
     STLArrayExample();
     
     return 0;
@@ -11,15 +11,90 @@
 
 #include <stack>
 #include <map>
+#include <set>
 #include <unordered_map>
 #include <vector>
 #include <array>
+#include <list>
+#include <deque>
+#include <span>
 #include <utility>
 #include <algorithm>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <tuple>
+#include <cstdint>
+#include <bit>
+#include <memory>
+#include <stdexcept>
+#include <new>
+#include <cstddef>
+#include <type_traits>
+#include <initializer_list>
+#include <ranges>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <limits>
+#include <version>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <queue>
+#include <barrier>
+
+// Execution policy overloads of sort() - eg g.sort( std::execution::par_unseq )
+// Opt in by defining SNICHOLLS_TOPOLOGICAL_EXECUTION 1 before including this header - ignored where the standard library has no <execution>
+// Off by default because with gcc <execution> pulls in Intel TBB, and every program including this header would then need -ltbb
+#ifndef SNICHOLLS_TOPOLOGICAL_EXECUTION
+#define SNICHOLLS_TOPOLOGICAL_EXECUTION 0
+#endif
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION && defined(__cpp_lib_execution) && __has_include(<execution>)
+#include <execution>
+#else
+#undef SNICHOLLS_TOPOLOGICAL_EXECUTION
+#define SNICHOLLS_TOPOLOGICAL_EXECUTION 0
+#endif
+
+// Coroutine executor - topological_task and topological_async_executor - wherever the compiler supports C++20 coroutines
+// On Linux it has its own epoll event loop, so a task can co_await a file descriptor becoming readable or writable without holding a thread
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define SNICHOLLS_TOPOLOGICAL_COROUTINES 1
+#else
+#define SNICHOLLS_TOPOLOGICAL_COROUTINES 0
+#endif
+#if SNICHOLLS_TOPOLOGICAL_COROUTINES && defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <system_error>
+#define SNICHOLLS_TOPOLOGICAL_EPOLL 1
+#else
+#define SNICHOLLS_TOPOLOGICAL_EPOLL 0
+#endif
 
 //
 // Header only adapter to enable topological sorting of STL containers
 // We only include the commonly used containers - std::map, std::unordered_map, std::vector, std::array - easy to generalise to the rest of the STL library
+// topological_sort_flat_map is a flat associative container over sorted contiguous keys and values
+// topological_sort_multimap and topological_sort_multiset emit each key's run of elements at once
+// topological_sort_keyed_vector orders a std::vector of records by a key projected from each element
+// topological_sort_list, topological_sort_deque and topological_sort_span reorder their elements in place
+// views::topological( g ) lazily yields any forward range in topological order
+// g.freeze() takes an immutable, thread shareable snapshot of the DAG for repeated sorting
+// g.weigh( key, w ) and g.precede( v, w, weight ) weight the DAG - g.critical_path(), g.longest_path( a, b ) and g.shortest_path( a, b ) take one sweep
+// g.pert() gives the earliest and latest start and finish, and the slack, of every vertex
+// g.fold( init, combine ) evaluates a recurrence over the predecessors of every vertex, level by level across threads
+// g.list_schedule( k, cost ) assigns the vertices to k workers with start times, critical path first
+// g.prepare(), g.get_ready() and g.done( key ) hand out vertices as their predecessors finish - to drive concurrent workers
+// g.prepare_concurrent( n ) does the same for n worker threads with atomic counters and work stealing deques - no locks
+// topological_executor runs a callable per key on a pool of threads, each as soon as its predecessors have finished
+// topological_async_executor runs a coroutine per key - with an epoll loop on Linux for vertices waiting on I/O
 //
 
 namespace snicholls {
@@ -38,100 +113,3488 @@ namespace snicholls {
         }
     }
 
-    // Note: we are NOT checking for cycles
-    // Complexity O(V+E) where V are the number of vertices in the DAG and E is the number of edges
+    // Number of rows gathered per column before moving on to the next column in apply_permutation
+    // 4096 32 bit indices is 16K - the block of the permutation stays in L1 while every column is gathered
+    inline constexpr std::size_t permutation_block_size = 4096;
+
+    namespace detail {
+    
+        template <typename Column>
+        auto make_gather_buffer( Column& column, std::size_t n )
+        {
+            Column buffer( column.get_allocator() );
+            if constexpr ( requires { buffer.reserve(n); } )
+                buffer.reserve(n);
+            return buffer;
+        }
+    
+        template <typename Index, typename Columns, typename Buffers, std::size_t... I>
+        void gather_blocks( const std::vector<Index>& perm, Columns& columns, Buffers& buffers, std::index_sequence<I...> )
+        {
+            for ( std::size_t lo{0}; lo < perm.size(); lo += permutation_block_size )
+            {
+                const auto hi = std::min( lo + permutation_block_size, perm.size() );
+                ( [&]( auto& column, auto& buffer ) {
+                    for ( auto i = lo; i < hi; ++i )
+                        buffer.push_back( std::move( column[ perm[i] ] ) );
+                }( std::get<I>(columns), std::get<I>(buffers) ), ... );
+            }
+        }
+    
+        // Counting sort of the positions 0..ranks.size() by rank - stable
+        template <typename Index>
+        std::vector< Index > counting_order( const std::vector< std::size_t >& ranks, std::size_t buckets )
+        {
+            // offsets[r] is where the first element of rank r goes
+            std::vector< std::size_t > offsets( buckets + 1, 0 );
+            for ( auto r : ranks ) ++offsets[r + 1];
+            std::partial_sum( offsets.begin(), offsets.end(), offsets.begin() );
+            
+            std::vector< Index > order( ranks.size() );
+            for ( std::size_t i{0}; i < ranks.size(); ++i )
+                order[ offsets[ ranks[i] ]++ ] = static_cast< Index >( i );
+            return order;
+        }
+    
+    } // namespace detail
+
+    // Reorder any number of parallel columns so that row i becomes row perm[i] of the original - eg with a permutation from topological_sorter::permutation
+    // Every column must have perm.size() rows and a get_allocator(), push_back() and operator[] - std::vector and std::deque both qualify
+    // Rows are gathered a block at a time across all the columns - one pass over the permutation, each element moved once
+    template <typename Index, typename... Columns>
+    void apply_permutation( const std::vector<Index>& perm, Columns&... columns )
+    {
+        auto refs    = std::forward_as_tuple( columns... );
+        auto buffers = std::make_tuple( detail::make_gather_buffer( columns, perm.size() )... );
+        
+        detail::gather_blocks( perm, refs, buffers, std::index_sequence_for<Columns...>{} );
+        
+        std::apply( [&]( auto&... buffer ) { ( ( columns = std::move(buffer) ), ... ); }, buffers );
+    }
+
+    //
+    // Flat open addressing hash map used by the sorter behind std::unordered_map
+    // Entries live contiguously in insertion order - iteration is a walk over a std::vector and is deterministic
+    // The hash table only holds 32 bit indices into the entries, linear probing, kept at most half full - the hash is mixed, so weak hashes do not cluster
+    // Only what the sorter needs - no erase. Inserting may invalidate iterators and references, as with std::vector
+    //
+
+    template<
+        class Key,
+        class T,
+        class Hash = std::hash<Key>,
+        class KeyEqual = std::equal_to<Key>,
+        class Allocator = std::allocator<std::pair<Key, T>> >
+    class flat_hash_map
+    {
+    public:
+        using key_type          = Key;
+        using mapped_type       = T;
+        using value_type        = std::pair<Key, T>;
+        using size_type         = std::size_t;
+        using hasher            = Hash;
+        using key_equal         = KeyEqual;
+        using allocator_type    = Allocator;
+        using entries_type      = std::vector< value_type, Allocator >;
+        using iterator          = typename entries_type::iterator;
+        using const_iterator    = typename entries_type::const_iterator;
+        
+        flat_hash_map() = default;
+        
+        flat_hash_map( const Hash& hash, const KeyEqual& equal, const Allocator& alloc = Allocator() ) :
+            entries( alloc ), slots( slot_allocator( alloc ) ), hash( hash ), equal( equal ) {};
+        
+        iterator begin()                { return entries.begin(); }
+        iterator end()                  { return entries.end(); }
+        const_iterator begin() const    { return entries.begin(); }
+        const_iterator end() const      { return entries.end(); }
+        
+        size_type size() const          { return entries.size(); }
+        bool empty() const              { return entries.empty(); }
+        
+        void clear()
+        {
+            entries.clear();
+            std::fill( slots.begin(), slots.end(), empty_slot );
+        }
+        
+        void reserve( size_type n )
+        {
+            entries.reserve( n );
+            if ( 2 * n > slots.size() )
+                rehash( std::bit_ceil( 2 * n ) );
+        }
+        
+        iterator find( const Key& key )
+        {
+            auto i = lookup( key );
+            return i == empty_slot ? end() : begin() + i;
+        }
+        
+        const_iterator find( const Key& key ) const
+        {
+            auto i = lookup( key );
+            return i == empty_slot ? end() : begin() + i;
+        }
+        
+        size_type count( const Key& key ) const { return lookup( key ) == empty_slot ? 0 : 1; }
+        bool contains( const Key& key ) const   { return lookup( key ) != empty_slot; }
+        
+        T& at( const Key& key )
+        {
+            auto i = lookup( key );
+            if ( i == empty_slot ) throw std::out_of_range( "snicholls::flat_hash_map::at" );
+            return entries[i].second;
+        }
+        
+        const T& at( const Key& key ) const
+        {
+            auto i = lookup( key );
+            if ( i == empty_slot ) throw std::out_of_range( "snicholls::flat_hash_map::at" );
+            return entries[i].second;
+        }
+        
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace( const Key& key, Args&&... args )
+        {
+            if ( 2 * ( entries.size() + 1 ) > slots.size() )
+                rehash( std::max< size_type >( 16, 2 * slots.size() ) );
+            
+            // Linear probe - either we find the key or the empty slot it belongs in
+            const auto mask = slots.size() - 1;
+            for ( auto pos = home( key, slots.size() ) ;; pos = ( pos + 1 ) & mask )
+            {
+                if ( slots[pos] == empty_slot )
+                {
+                    slots[pos] = static_cast< std::uint32_t >( entries.size() );
+                    entries.emplace_back( std::piecewise_construct, std::forward_as_tuple( key ), std::forward_as_tuple( std::forward<Args>(args)... ) );
+                    return { end() - 1, true };
+                }
+                if ( equal( entries[ slots[pos] ].first, key ) )
+                    return { begin() + slots[pos], false };
+            }
+        }
+        
+        T& operator[]( const Key& key ) { return try_emplace( key ).first->second; }
+        
+    private:
+        using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc< std::uint32_t >;
+        static constexpr std::uint32_t empty_slot = ~std::uint32_t{0};
+        
+        // First slot to probe for key in a table of n slots, n a power of two
+        // Fibonacci hashing - multiply by 2^64 / golden ratio and keep the top bits, so every bit of the hash counts
+        // std::hash of an integer or a pointer is often the identity, and keys with a power of two stride would otherwise share their low bits
+        size_type home( const Key& key, size_type n ) const
+        {
+            const auto mixed = static_cast< std::uint64_t >( hash( key ) ) * 0x9E3779B97F4A7C15ull;
+            return static_cast< size_type >( mixed >> ( 64 - std::countr_zero( n ) ) );
+        }
+        
+        // Index of key in entries or empty_slot
+        std::uint32_t lookup( const Key& key ) const
+        {
+            if ( slots.empty() ) return empty_slot;
+            
+            const auto mask = slots.size() - 1;
+            for ( auto pos = home( key, slots.size() ) ;; pos = ( pos + 1 ) & mask )
+                if ( slots[pos] == empty_slot || equal( entries[ slots[pos] ].first, key ) )
+                    return slots[pos];
+        }
+        
+        // n is a power of two - reinsert every entry's index, the entries themselves never move
+        void rehash( size_type n )
+        {
+            slots.assign( n, empty_slot );
+            
+            const auto mask = n - 1;
+            for ( std::uint32_t i{0}; i < entries.size(); ++i )
+            {
+                auto pos = home( entries[i].first, n );
+                while ( slots[pos] != empty_slot ) pos = ( pos + 1 ) & mask;
+                slots[pos] = i;
+            }
+        }
+        
+        entries_type entries;
+        std::vector< std::uint32_t, slot_allocator > slots;
+        [[no_unique_address]] Hash hash;
+        [[no_unique_address]] KeyEqual equal;
+    };  // class flat_hash_map
+
+    //
+    // Direct indexed map for integral and enum keys - a plain array indexed by key, no hashing and no tree
+    // Covers the range of keys seen so far, [lo, lo + size), and grows geometrically at either end as new keys arrive
+    // Meant for small dense keys such as task ids - memory is proportional to the range of the keys, so the range is bounded
+    // Once it would exceed dense_factor times the number of keys, and dense_range, the entries move to a std::map and stay there
+    // Iterates in ascending key order either way, the same order as std::map with std::less
+    //
+
+    template < class Key, class T >
+        requires ( std::is_integral_v<Key> || std::is_enum_v<Key> )
+    class direct_index_map
+    {
+        using sparse_type       = std::map< Key, T >;
+        
+    public:
+        using key_type          = Key;
+        using mapped_type       = T;
+        using value_type        = std::pair<const Key, T>;
+        using size_type         = std::size_t;
+        
+        // Ranges up to dense_range keys are always direct indexed, wider ones while at least one in dense_factor of the keys is present
+        static constexpr size_type dense_range  = 4096;
+        static constexpr size_type dense_factor = 8;
+        
+        // Walks the present slots in key order - or the std::map once the keys have gone sparse
+        template <bool Const>
+        class basic_iterator
+        {
+        public:
+            using owner_type        = std::conditional_t< Const, const direct_index_map, direct_index_map >;
+            using node_type         = std::conditional_t< Const, typename sparse_type::const_iterator, typename sparse_type::iterator >;
+            using value_type        = direct_index_map::value_type;
+            using reference         = std::conditional_t< Const, const value_type&, value_type& >;
+            using pointer           = std::conditional_t< Const, const value_type*, value_type* >;
+            using difference_type   = std::ptrdiff_t;
+            using iterator_category = std::forward_iterator_tag;
+            
+            basic_iterator() = default;
+            basic_iterator( owner_type* owner, size_type slot ) : owner( owner ), slot( slot ) { skip(); };
+            basic_iterator( owner_type* owner, node_type node ) : owner( owner ), node( node ) {};
+            
+            operator basic_iterator<true>() const requires ( !Const )
+            {
+                return owner->sparse ? basic_iterator<true>{ owner, typename sparse_type::const_iterator( node ) } : basic_iterator<true>{ owner, slot };
+            }
+            
+            reference operator*() const { return owner->sparse ? *node : owner->slots[slot]; }
+            pointer operator->() const  { return &**this; }
+            
+            basic_iterator& operator++()
+            {
+                if ( owner->sparse ) ++node;
+                else { ++slot; skip(); }
+                return *this;
+            }
+            basic_iterator operator++(int)  { auto it = *this; ++*this; return it; }
+            
+            bool operator==( const basic_iterator& other ) const { return owner && owner->sparse ? node == other.node : slot == other.slot; }
+            
+        private:
+            void skip() { while ( slot < owner->slots.size() && !owner->present[slot] ) ++slot; }
+            
+            owner_type* owner{ nullptr };
+            size_type   slot{ 0 };
+            node_type   node{};
+        };
+        
+        using iterator          = basic_iterator<false>;
+        using const_iterator    = basic_iterator<true>;
+        
+        iterator begin()                { return sparse ? iterator{ this, sparse->begin() } : iterator{ this, 0 }; }
+        iterator end()                  { return sparse ? iterator{ this, sparse->end() } : iterator{ this, slots.size() }; }
+        const_iterator begin() const    { return sparse ? const_iterator{ this, sparse->cbegin() } : const_iterator{ this, 0 }; }
+        const_iterator end() const      { return sparse ? const_iterator{ this, sparse->cend() } : const_iterator{ this, slots.size() }; }
+        
+        size_type size() const          { return sparse ? sparse->size() : n; }
+        bool empty() const              { return size() == 0; }
+        
+        // True once the keys have been too spread out to index directly
+        bool is_sparse() const          { return sparse.has_value(); }
+        
+        void clear()
+        {
+            slots.clear();
+            present.clear();
+            sparse.reset();
+            n = 0;
+        }
+        
+        iterator find( const Key& key )
+        {
+            if ( sparse ) return { this, sparse->find( key ) };
+            return covers( key ) && present[ index( key ) ] ? iterator{ this, index( key ) } : end();
+        }
+        
+        const_iterator find( const Key& key ) const
+        {
+            if ( sparse ) return { this, typename sparse_type::const_iterator( sparse->find( key ) ) };
+            return covers( key ) && present[ index( key ) ] ? const_iterator{ this, index( key ) } : end();
+        }
+        
+        size_type count( const Key& key ) const { return find( key ) == end() ? 0 : 1; }
+        bool contains( const Key& key ) const   { return find( key ) != end(); }
+        
+        T& at( const Key& key )
+        {
+            auto it = find( key );
+            if ( it == end() ) throw std::out_of_range( "snicholls::direct_index_map::at" );
+            return it->second;
+        }
+        
+        const T& at( const Key& key ) const
+        {
+            auto it = find( key );
+            if ( it == end() ) throw std::out_of_range( "snicholls::direct_index_map::at" );
+            return it->second;
+        }
+        
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace( const Key& key, Args&&... args )
+        {
+            if ( !sparse && !covers( key ) )
+            {
+                if ( too_wide( key ) ) go_sparse();
+                else grow( key );
+            }
+            
+            if ( sparse )
+            {
+                auto [it, inserted] = sparse->try_emplace( key, std::forward<Args>(args)... );
+                return { iterator{ this, it }, inserted };
+            }
+            
+            const auto slot = index( key );
+            if ( present[slot] )
+                return { iterator{ this, slot }, false };
+            
+            if constexpr ( sizeof...(Args) > 0 )
+                slots[slot].second = T( std::forward<Args>(args)... );
+            present[slot] = true;
+            ++n;
+            return { iterator{ this, slot }, true };
+        }
+        
+        T& operator[]( const Key& key ) { return try_emplace( key ).first->second; }
+        
+    private:
+        using underlying_type = typename std::conditional_t< std::is_enum_v<Key>, std::underlying_type<Key>, std::type_identity<Key> >::type;
+        
+        static underlying_type value( const Key& key ) { return static_cast< underlying_type >( key ); }
+        
+        // Unsigned distance from lo - modular arithmetic is exact for any key type as long as the range fits
+        size_type index( const Key& key ) const
+        {
+            return static_cast< size_type >( static_cast< std::uintmax_t >( value( key ) ) - static_cast< std::uintmax_t >( value( lo ) ) );
+        }
+        
+        bool covers( const Key& key ) const
+        {
+            return !slots.empty() && value( lo ) <= value( key ) && index( key ) < slots.size();
+        }
+        
+        // Would covering key span more than the bound - the distance between the lowest and highest keys, unsigned so it cannot overflow
+        bool too_wide( const Key& key ) const
+        {
+            if ( slots.empty() ) return false;
+            const auto hi = static_cast< underlying_type >( static_cast< std::uintmax_t >( value( lo ) ) + ( slots.size() - 1 ) );
+            const auto span = static_cast< std::uintmax_t >( std::max( hi, value( key ) ) ) - static_cast< std::uintmax_t >( std::min( value( lo ), value( key ) ) );
+            return span >= std::max< std::uintmax_t >( dense_range, dense_factor * ( std::uintmax_t{ n } + 1 ) );
+        }
+        
+        // Move the present entries to a std::map - in key order, so each insert is at the end
+        void go_sparse()
+        {
+            sparse.emplace();
+            for ( size_type slot{0}; slot < slots.size(); ++slot )
+                if ( present[slot] ) sparse->emplace_hint( sparse->end(), slots[slot].first, std::move( slots[slot].second ) );
+            
+            slots = std::vector< value_type >();
+            present = std::vector< bool >();
+            n = 0;
+        }
+        
+        // Extend the range to cover key, with slack at the end we grew - slots that are not present hold a default T
+        void grow( const Key& key )
+        {
+            std::uintmax_t first, count;
+            if ( slots.empty() )
+            {
+                first = static_cast< std::uintmax_t >( value( key ) );
+                count = 1;
+            }
+            else if ( value( key ) < value( lo ) )
+            {
+                const auto need = static_cast< std::uintmax_t >( value( lo ) ) - static_cast< std::uintmax_t >( value( key ) );
+                const auto room = static_cast< std::uintmax_t >( value( key ) ) - static_cast< std::uintmax_t >( std::numeric_limits<underlying_type>::min() );
+                const auto slack = std::min< std::uintmax_t >( slots.size(), room );
+                first = static_cast< std::uintmax_t >( value( key ) ) - slack;
+                count = slots.size() + need + slack;
+            }
+            else
+            {
+                const auto need = index( key ) + 1 - slots.size();
+                const auto room = static_cast< std::uintmax_t >( std::numeric_limits<underlying_type>::max() ) - static_cast< std::uintmax_t >( value( key ) );
+                first = static_cast< std::uintmax_t >( value( lo ) );
+                count = slots.size() + need + std::min< std::uintmax_t >( slots.size(), room );
+            }
+            
+            const auto new_lo = static_cast< Key >( static_cast< underlying_type >( first ) );
+            std::vector< value_type > new_slots;
+            new_slots.reserve( static_cast< size_type >( count ) );
+            std::vector< bool > new_present( static_cast< size_type >( count ), false );
+            
+            for ( std::uintmax_t i{0}; i < count; ++i )
+            {
+                const auto key_i = static_cast< Key >( static_cast< underlying_type >( first + i ) );
+                if ( covers( key_i ) )
+                {
+                    const auto slot = index( key_i );
+                    new_slots.emplace_back( key_i, std::move( slots[slot].second ) );
+                    new_present[ static_cast< size_type >( i ) ] = present[slot];
+                }
+                else
+                    new_slots.emplace_back( key_i, T() );
+            }
+            
+            slots = std::move( new_slots );
+            present = std::move( new_present );
+            lo = new_lo;
+        }
+        
+        std::vector< value_type >       slots;
+        std::vector< bool >             present;
+        Key                             lo{};
+        size_type                       n{ 0 };
+        std::optional< sparse_type >    sparse;     // set once the keys are too spread out - then the only storage
+    };  // class direct_index_map
+
+    //
+    // Vector with room for the first N elements inside the object itself - only spills to the heap beyond N
+    // The sorter keeps each vertex's successors in one of these - most vertices have one or two successors and never allocate
+    // Only what the sorter needs - a subset of the std::vector interface
+    //
+
+    template < class T, std::size_t N >
+    class small_vector
+    {
+    public:
+        using value_type        = T;
+        using size_type         = std::size_t;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = T&;
+        using const_reference   = const T&;
+        using pointer           = T*;
+        using const_pointer     = const T*;
+        using iterator          = T*;
+        using const_iterator    = const T*;
+        
+        small_vector() = default;
+        
+        small_vector( std::initializer_list<T> il )
+        {
+            reserve( il.size() );
+            for ( const auto& x : il ) push_back( x );
+        }
+        
+        small_vector( const small_vector& other )
+        {
+            reserve( other.size() );
+            for ( const auto& x : other ) push_back( x );
+        }
+        
+        // Steals the heap buffer if there is one, otherwise moves the inline elements across
+        small_vector( small_vector&& other ) noexcept( std::is_nothrow_move_constructible_v<T> )
+        {
+            take( std::move( other ) );
+        }
+        
+        small_vector& operator=( const small_vector& other )
+        {
+            if ( this != &other )
+            {
+                clear();
+                reserve( other.size() );
+                for ( const auto& x : other ) push_back( x );
+            }
+            return *this;
+        }
+        
+        small_vector& operator=( small_vector&& other ) noexcept( std::is_nothrow_move_constructible_v<T> )
+        {
+            if ( this != &other )
+            {
+                release();
+                take( std::move( other ) );
+            }
+            return *this;
+        }
+        
+        ~small_vector() { release(); }
+        
+        iterator begin()                { return data_; }
+        iterator end()                  { return data_ + size_; }
+        const_iterator begin() const    { return data_; }
+        const_iterator end() const      { return data_ + size_; }
+        
+        T* data()                       { return data_; }
+        const T* data() const           { return data_; }
+        size_type size() const          { return size_; }
+        size_type capacity() const      { return capacity_; }
+        bool empty() const              { return size_ == 0; }
+        
+        // Still inline - no heap buffer
+        bool is_inline() const          { return data_ == inline_data(); }
+        
+        T& operator[]( size_type i )                { return data_[i]; }
+        const T& operator[]( size_type i ) const    { return data_[i]; }
+        T& front()                                  { return data_[0]; }
+        const T& front() const                      { return data_[0]; }
+        T& back()                                   { return data_[size_ - 1]; }
+        const T& back() const                       { return data_[size_ - 1]; }
+        
+        void reserve( size_type n )
+        {
+            if ( n <= capacity_ ) return;
+            
+            auto* p = std::allocator<T>{}.allocate( n );
+            std::uninitialized_move( begin(), end(), p );
+            std::destroy( begin(), end() );
+            if ( !is_inline() ) std::allocator<T>{}.deallocate( data_, capacity_ );
+            data_ = p;
+            capacity_ = n;
+        }
+        
+        template <typename... Args>
+        T& emplace_back( Args&&... args )
+        {
+            if ( size_ == capacity_ )
+            {
+                // args may refer to one of our own elements - build the new element before the buffer moves
+                T x( std::forward<Args>(args)... );
+                reserve( 2 * capacity_ );
+                return emplace_back( std::move(x) );
+            }
+            auto* p = std::construct_at( data_ + size_, std::forward<Args>(args)... );
+            ++size_;
+            return *p;
+        }
+        
+        void push_back( const T& x )    { emplace_back( x ); }
+        void push_back( T&& x )         { emplace_back( std::move(x) ); }
+        
+        void pop_back()
+        {
+            --size_;
+            std::destroy_at( data_ + size_ );
+        }
+        
+        void clear()
+        {
+            std::destroy( begin(), end() );
+            size_ = 0;
+        }
+        
+        friend bool operator==( const small_vector& a, const small_vector& b )
+        {
+            return std::equal( a.begin(), a.end(), b.begin(), b.end() );
+        }
+        
+    private:
+        T* inline_data()                { return std::launder( reinterpret_cast< T* >( inline_ ) ); }
+        const T* inline_data() const    { return std::launder( reinterpret_cast< const T* >( inline_ ) ); }
+        
+        // Destroy the elements and give back the heap buffer - back to empty and inline
+        void release()
+        {
+            clear();
+            if ( !is_inline() ) std::allocator<T>{}.deallocate( data_, capacity_ );
+            data_ = inline_data();
+            capacity_ = N;
+        }
+        
+        // *this is empty and inline
+        void take( small_vector&& other )
+        {
+            if ( other.is_inline() )
+            {
+                std::uninitialized_move( other.begin(), other.end(), data_ );
+                size_ = other.size_;
+                other.clear();
+            }
+            else
+            {
+                data_ = std::exchange( other.data_, other.inline_data() );
+                size_ = std::exchange( other.size_, 0 );
+                capacity_ = std::exchange( other.capacity_, N );
+            }
+        }
+        
+        T*          data_{ inline_data() };
+        size_type   size_{ 0 };
+        size_type   capacity_{ N };
+        alignas(T) std::byte inline_[ N * sizeof(T) ];
+    };  // class small_vector
+
+    // Successors held inside each adjacency entry before spilling to the heap - about 16 bytes worth, at least one
     template <typename Key>
-    struct topological_sorter
+    inline constexpr std::size_t inline_successors = std::max< std::size_t >( 1, 16 / sizeof(Key) );
+
+    //
+    // String interning pool - each distinct string is stored exactly once, back to back in one contiguous arena
+    // A string is known by a 32 bit handle - 0, 1, 2 ... in order of first intern() - so handles index plain arrays
+    // The hash table only holds handles, strings are compared through the arena, so growing the arena is safe
+    // Views returned by operator[] are invalidated by the next intern() of a new string, as with std::vector
+    //
+
+    template < class Hash = std::hash<std::string_view> >
+    class basic_string_pool
     {
-        using stack_type = std::stack< Key >;
-        using visited_type = std::map< Key, bool>;
-        using adjacency_type = std::map< Key, std::vector<Key> >;
-         
-        // result type for an associative container - std::map, std::unordered_map
-        template <typename T>
-        using associative_sort_type = std::vector< std::pair<const Key, T> >;
+    public:
+        using handle_type = std::uint32_t;
+        using size_type   = std::size_t;
         
-        // result type for std::vector
-        template <typename T>
-        using vector_sort_type = std::vector< T >;
+        static constexpr handle_type npos = ~handle_type{0};
         
-        // result type for std::array
-        template <typename T, std::size_t N>
-        using array_sort_type = std::array< T, N >;
+        // Handle of s - added to the pool if this is the first time we have seen it
+        handle_type intern( std::string_view s )
+        {
+            const auto h = hash( s );
+            if ( 2 * ( size() + 1 ) > slots.size() )
+                rehash( std::max< size_type >( 16, 2 * slots.size() ) );
+            
+            const auto mask = slots.size() - 1;
+            for ( auto pos = h & mask ;; pos = ( pos + 1 ) & mask )
+            {
+                if ( slots[pos] == npos )
+                {
+                    const auto handle = static_cast< handle_type >( size() );
+                    arena.insert( arena.end(), s.begin(), s.end() );
+                    offsets.push_back( static_cast< std::uint32_t >( arena.size() ) );
+                    hashes.push_back( h );
+                    slots[pos] = handle;
+                    return handle;
+                }
+                if ( hashes[ slots[pos] ] == h && (*this)[ slots[pos] ] == s )
+                    return slots[pos];
+            }
+        }
+        
+        // Handle of s or npos - never adds
+        handle_type find( std::string_view s ) const
+        {
+            if ( slots.empty() ) return npos;
+            
+            const auto h = hash( s );
+            const auto mask = slots.size() - 1;
+            for ( auto pos = h & mask ;; pos = ( pos + 1 ) & mask )
+                if ( slots[pos] == npos || ( hashes[ slots[pos] ] == h && (*this)[ slots[pos] ] == s ) )
+                    return slots[pos];
+        }
+        
+        std::string_view operator[]( handle_type handle ) const
+        {
+            return { arena.data() + offsets[handle], offsets[handle + 1] - offsets[handle] };
+        }
+        
+        // Number of distinct strings
+        size_type size() const  { return hashes.size(); }
+        bool empty() const      { return hashes.empty(); }
+        
+        // Characters held in the arena
+        size_type bytes() const { return arena.size(); }
+        
+        void clear()
+        {
+            arena.clear();
+            offsets.assign( 1, 0 );
+            hashes.clear();
+            std::fill( slots.begin(), slots.end(), npos );
+        }
+        
+    private:
+        // n is a power of two
+        void rehash( size_type n )
+        {
+            slots.assign( n, npos );
+            
+            const auto mask = n - 1;
+            for ( handle_type handle{0}; handle < size(); ++handle )
+            {
+                auto pos = hashes[handle] & mask;
+                while ( slots[pos] != npos ) pos = ( pos + 1 ) & mask;
+                slots[pos] = handle;
+            }
+        }
+        
+        std::vector< char >             arena;
+        std::vector< std::uint32_t >    offsets{ 0 };   // string i is arena[ offsets[i], offsets[i+1] )
+        std::vector< std::size_t >      hashes;         // by handle - rehashing never touches the arena
+        std::vector< handle_type >      slots;
+        [[no_unique_address]] Hash      hash;
+    };  // class basic_string_pool
+
+    using string_pool = basic_string_pool<>;
+
+    //
+    // Sorter traits - how the sorter represents its vertices and the map types it keeps its adjacency, visited flags and ranks in
+    // map_type<V> is keyed by Key, vertex_map_type<V> by vertex_type
+    // Both need operator[], find(), try_emplace() and iteration over std::pair-like ( key, value ) entries
+    // intern() gives the vertex of a key - adding it to the pool if need be - key() gives the key back and find() the vertex of a key already seen, if any
+    // make_map<M>( state ) builds an empty map of either kind from map_state_type - eg the Hash and KeyEqual instances of a container
+    //
+
+    // Vertices are the keys themselves - there is no pool, and the maps need nothing to be built
+    template < class Key >
+    struct key_vertices
+    {
+        using vertex_type = Key;
+        
+        struct pool_type {};
+        struct map_state_type {};
+        
+        static const Key& intern( pool_type&, const Key& key )          { return key; }
+        static const Key& key( const pool_type&, const Key& vertex )    { return vertex; }
+        static const Key* find( const pool_type&, const Key& key )      { return &key; }
+        
+        template <typename Map>
+        static Map make_map( const map_state_type& )                    { return Map(); }
+    };
+
+    // Tree based - keys need a Compare
+    template < class Key, class Compare = std::less<Key> >
+    struct ordered_sorter_traits : key_vertices<Key>
+    {
+        template <typename V>
+        using map_type = std::map< Key, V, Compare >;
+        
+        template <typename V>
+        using vertex_map_type = map_type<V>;
+    };
+
+    // Hash based - keys need only Hash and KeyEqual, O(1) lookups
+    // Allocator is the container's allocator and is rebound to the entries of each map
+    // Every map is built from the same Hash, KeyEqual and Allocator instances - eg a seeded hasher or an arena taken from the container, see topological_sort_unordered_map
+    template <
+        class Key,
+        class Hash = std::hash<Key>,
+        class KeyEqual = std::equal_to<Key>,
+        class Allocator = std::allocator<Key> >
+    struct hashed_sorter_traits : key_vertices<Key>
+    {
+        template <typename V>
+        using map_type = flat_hash_map< Key, V, Hash, KeyEqual, typename std::allocator_traits<Allocator>::template rebind_alloc< std::pair<Key, V> > >;
+        
+        template <typename V>
+        using vertex_map_type = map_type<V>;
+        
+        struct map_state_type
+        {
+            [[no_unique_address]] Hash      hash{};
+            [[no_unique_address]] KeyEqual  equal{};
+            [[no_unique_address]] Allocator alloc{};
+        };
+        
+        template <typename Map>
+        static Map make_map( const map_state_type& state )
+        {
+            return Map( state.hash, state.equal, typename Map::allocator_type( state.alloc ) );
+        }
+    };
+
+    // Direct indexed - integral and enum keys, plain arrays indexed by key
+    template < class Key >
+    struct indexed_sorter_traits : key_vertices<Key>
+    {
+        template <typename V>
+        using map_type = direct_index_map< Key, V >;
+        
+        template <typename V>
+        using vertex_map_type = map_type<V>;
+    };
+
+    // Interned - std::string keys are stored once in a string_pool and the graph is built over 32 bit handles
+    // Opt in, eg topological_sorter< std::string, interned_sorter_traits > - vertices are then visited in first mention order, not alphabetically, and adj is keyed by handle
+    // The adjacency, the depth first search and the snapshots are plain arrays indexed by handle, compared as integers - a snapshot shares the pool rather than copying the strings
+    // Maps keyed by the strings themselves - the rank tables and the adapters' bookkeeping - are flat hash maps
+    struct interned_sorter_traits
+    {
+        using vertex_type = string_pool::handle_type;
+        using pool_type   = string_pool;
+        
+        struct map_state_type {};
+        
+        template <typename V>
+        using map_type = flat_hash_map< std::string, V >;
+        
+        template <typename V>
+        using vertex_map_type = direct_index_map< vertex_type, V >;
+        
+        static vertex_type intern( pool_type& pool, const std::string& key )    { return pool.intern( key ); }
+        static std::string key( const pool_type& pool, vertex_type vertex )     { return std::string( pool[vertex] ); }
+        
+        static std::optional< vertex_type > find( const pool_type& pool, const std::string& key )
+        {
+            const auto handle = pool.find( key );
+            return handle == pool_type::npos ? std::nullopt : std::optional< vertex_type >( handle );
+        }
+        
+        template <typename Map>
+        static Map make_map( const map_state_type& )                            { return Map(); }
+    };
+
+    // What the sorter uses when not told otherwise - integral and enum keys are direct indexed, anything else goes in a std::map
+    // Integral keys that turn out to be sparse, eg hashes, fall back to a std::map inside direct_index_map - ordered_sorter_traits skips the array altogether
+    // std::string keys stay in a std::map, so otherwise unordered vertices come out alphabetically - interned_sorter_traits is opt in
+    template < class Key, class Compare = std::less<Key> >
+    using default_sorter_traits = std::conditional_t<
+        ( std::is_integral_v<Key> || std::is_enum_v<Key> ) && std::is_same_v< Compare, std::less<Key> >,
+        indexed_sorter_traits<Key>,
+        ordered_sorter_traits<Key, Compare> >;
+
+    // Reorder [first, first + order.size()) in place so that position i receives the element that was at order[i]
+    // Follows each cycle of the permutation with a single temporary - every element is moved once, nothing else is allocated
+    // order is consumed - it is used to mark the positions already done
+    template <typename RandomIt, typename Index>
+    void permute_in_place( RandomIt first, std::vector<Index> order )
+    {
+        for ( std::size_t i{0}; i < order.size(); ++i )
+        {
+            if ( order[i] == i ) continue;
+            
+            auto tmp = std::move( first[i] );
+            auto j = i;
+            while ( order[j] != i )
+            {
+                auto k = static_cast< std::size_t >( order[j] );
+                first[j] = std::move( first[k] );
+                order[j] = static_cast< Index >( j );
+                j = k;
+            }
+            first[j] = std::move( tmp );
+            order[j] = static_cast< Index >( j );
+        }
+    }
+
+    //
+    // Static schedule of a DAG onto a number of workers - see frozen_topological_graph::list_schedule
+    // Indexed by the ids of the frozen graph - worker[v] runs v from start[v] to finish[v]
+    //
+
+    struct topological_schedule
+    {
+        std::vector< std::uint32_t >    worker;
+        std::vector< double >           start;
+        std::vector< double >           finish;
+        std::vector< std::uint32_t >    sequence;   // ids in the order they start
+        double                          makespan{ 0 };
+    };
+
+    //
+    // PERT / critical path method analysis - see frozen_topological_graph::pert
+    // Indexed by the ids of the frozen graph - a vertex with no slack is on a critical path
+    //
+
+    struct topological_pert
+    {
+        std::vector< double >   earliest_start;
+        std::vector< double >   earliest_finish;
+        std::vector< double >   latest_start;
+        std::vector< double >   latest_finish;
+        std::vector< double >   slack;          // latest_start - earliest_start
+        double                  makespan{ 0 };
+    };
+
+    //
+    // Immutable snapshot of a DAG - see topological_sorter::freeze
+    // Vertices have dense 32 bit ids and the ids ARE the topological order - id 0 comes first, an edge always goes from a lower id to a higher one
+    // Successors are in compressed sparse row ( CSR ) form - the successors of v are targets[ offsets[v], offsets[v+1] )
+    // Predecessors are the same again, transposed, so a vertex can pull from its predecessors as well as push to its successors
+    // Vertex and edge weights, 0 unless given, are flat arrays alongside - by id, and parallel to the targets and the sources
+    // So order() is the topological order, id( key ) is the rank of key and a forward pass over the ids is a topological sweep
+    // The vertices are kept as the sorter's traits keep them - the keys themselves, or handles into a pool shared with the sorter, which never changes it while we hold it
+    // Every member is const and nothing is cached - one snapshot can be read from any number of threads without synchronisation
+    //
+
+    template <typename Key, typename Traits>
+    class frozen_topological_graph
+    {
+    public:
+        using key_type      = Key;
+        using id_type       = std::uint32_t;
+        using size_type     = std::size_t;
+        using stack_type    = std::stack< Key >;
+        using vertex_type   = typename Traits::vertex_type;
+        using pool_type     = typename Traits::pool_type;
+        using index_type    = typename Traits::template vertex_map_type< id_type >;
+        using map_state_type = typename Traits::map_state_type;
+        
+        static constexpr id_type npos = ~id_type{0};
+        
+        frozen_topological_graph() = default;
+        
+        // vertices in topological order, CSR over their positions - as built by topological_sorter::freeze
+        // Weights may be left empty - they are then all 0
+        // The vertex index, and any map made later, is built from state - eg the sorter's Hash and KeyEqual
+        // pool is what the vertices are handles into - not needed when the vertices are the keys themselves
+        frozen_topological_graph( std::vector<vertex_type> vertices, std::vector<id_type> offsets, std::vector<id_type> targets,
+                                 std::vector<double> vertex_weights = {}, std::vector<double> edge_weights = {}, map_state_type state = {},
+                                 std::shared_ptr< const pool_type > pool = {} ) :
+            vertices_( std::move(vertices) ), offsets_( std::move(offsets) ), targets_( std::move(targets) ),
+            vertex_weights_( std::move(vertex_weights) ), edge_weights_( std::move(edge_weights) ),
+            pool_( std::move(pool) ), state_( std::move(state) ), index_( Traits::template make_map< index_type >( state_ ) )
+        {
+            for ( id_type v{0}; v < vertices_.size(); ++v )
+                index_.try_emplace( vertices_[v], v );
+            
+            vertex_weights_.resize( vertices_.size(), 0 );
+            edge_weights_.resize( targets_.size(), 0 );
+            
+            // Transpose - a counting sort of the edges by target, so each vertex's predecessors are in id order
+            in_offsets_.assign( vertices_.size() + 1, 0 );
+            for ( auto w : targets_ ) ++in_offsets_[w + 1];
+            std::partial_sum( in_offsets_.begin(), in_offsets_.end(), in_offsets_.begin() );
+            
+            sources_.resize( targets_.size() );
+            in_weights_.resize( targets_.size() );
+            std::vector< id_type > next( in_offsets_.begin(), in_offsets_.end() - 1 );
+            for ( id_type v{0}; v < vertices_.size(); ++v )
+                for ( auto k = offsets_[v]; k < offsets_[v + 1]; ++k )
+                {
+                    const auto slot = next[ targets_[k] ]++;
+                    sources_[slot] = v;
+                    in_weights_[slot] = edge_weights_[k];
+                }
+        }
+        
+        // Vertices in topological order with no edges - the order and ranks alone, as kept by topological_sorter::ordered
+        explicit frozen_topological_graph( std::vector<vertex_type> vertices, map_state_type state = {}, std::shared_ptr< const pool_type > pool = {} ) :
+            vertices_( std::move(vertices) ), offsets_( vertices_.size() + 1, 0 ), vertex_weights_( vertices_.size(), 0 ), in_offsets_( vertices_.size() + 1, 0 ),
+            pool_( std::move(pool) ), state_( std::move(state) ), index_( Traits::template make_map< index_type >( state_ ) )
+        {
+            for ( id_type v{0}; v < vertices_.size(); ++v )
+                index_.try_emplace( vertices_[v], v );
+        }
+        
+        size_type size() const      { return vertices_.size(); }
+        size_type edges() const     { return targets_.size(); }
+        bool empty() const          { return vertices_.empty(); }
+        
+        // Keys in topological order - the key of id v is order()[v]
+        // The std::vector of the keys themselves, or for interned keys a view that reads each one out of the pool as it is visited
+        decltype(auto) order() const
+        {
+            if constexpr ( std::is_same_v< vertex_type, Key > )
+                return ( vertices_ );
+            else
+                return std::views::transform( vertices_, [this]( const vertex_type& v ) { return Traits::key( pool(), v ); } );
+        }
+        decltype(auto) key( id_type v ) const   { return Traits::key( pool(), vertices_[v] ); }
+        
+        // Vertices in topological order, as the traits keep them - eg the handles of interned keys
+        const std::vector<vertex_type>& vertices() const    { return vertices_; }
+        
+        // Id - and so the rank - of a key, npos if it is not in the DAG
+        // An interned key is found in the pool and its handle looked up in a plain array - the strings are not hashed into a second map
+        id_type id( const Key& key ) const
+        {
+            auto vertex = Traits::find( pool(), key );
+            if ( !vertex ) return npos;
+            auto it = index_.find( *vertex );
+            return it == index_.end() ? npos : it->second;
+        }
+        id_type rank( const Key& key ) const    { return id( key ); }
+        bool contains( const Key& key ) const   { return id( key ) != npos; }
+        
+        std::span< const id_type > successors( id_type v ) const
+        {
+            return { targets_.data() + offsets_[v], targets_.data() + offsets_[v + 1] };
+        }
+        size_type out_degree( id_type v ) const { return offsets_[v + 1] - offsets_[v]; }
+        
+        std::span< const id_type > predecessors( id_type v ) const
+        {
+            return { sources_.data() + in_offsets_[v], sources_.data() + in_offsets_[v + 1] };
+        }
+        size_type in_degree( id_type v ) const  { return in_offsets_[v + 1] - in_offsets_[v]; }
+        
+        // Weights - of a vertex, of the edges to its successors and of the edges from its predecessors, in the same order as those
+        double weight( id_type v ) const                            { return vertex_weights_[v]; }
+        std::span< const double > successor_weights( id_type v ) const
+        {
+            return { edge_weights_.data() + offsets_[v], edge_weights_.data() + offsets_[v + 1] };
+        }
+        std::span< const double > predecessor_weights( id_type v ) const
+        {
+            return { in_weights_.data() + in_offsets_[v], in_weights_.data() + in_offsets_[v + 1] };
+        }
+        const std::vector<double>& weights() const                  { return vertex_weights_; }
+        
+        // The raw CSR arrays
+        const std::vector<id_type>& offsets() const     { return offsets_; }
+        const std::vector<id_type>& targets() const     { return targets_; }
+        const std::vector<id_type>& in_offsets() const  { return in_offsets_; }
+        const std::vector<id_type>& sources() const     { return sources_; }
+        
+        // Same result as topological_sorter::topological_sort at the time of the freeze
+        stack_type topological_sort() const
+        {
+            stack_type s;
+            for ( auto v = size(); v-- > 0; ) s.push( key( static_cast< id_type >(v) ) );
+            return s;
+        }
+        
+        // As topological_sorter::rank_order - a rank lookup per element and a counting sort, nothing else is touched
+        // Keys that are not in the DAG are placed last, in order of first appearance
+        template <typename Index = std::size_t, typename ForwardIt, typename Proj>
+        std::vector< Index > rank_order( ForwardIt first, ForwardIt last, Proj&& proj ) const
+        {
+            auto next = size();
+            auto unranked = Traits::template make_map< typename Traits::template map_type< std::size_t > >( state_ );
+            
+            std::vector< std::size_t > ranks;
+            for ( auto it = first; it != last; ++it )
+            {
+                // *it may be a temporary - a proxy or a prvalue - so keep it alive for as long as key refers into it
+                auto&& elem = *it;
+                const auto& key = std::invoke( proj, elem );
+                if ( auto r = id( key ); r != npos )
+                    ranks.push_back( r );
+                else
+                {
+                    auto [pos, inserted] = unranked.try_emplace( key, next );
+                    if ( inserted ) ++next;
+                    ranks.push_back( pos->second );
+                }
+            }
+            return detail::counting_order< Index >( ranks, next );
+        }
+        
+        // As topological_sorter::permutation
+        template <typename Range, typename Proj = std::identity>
+        std::vector< std::uint32_t > permutation( const Range& keys, Proj&& proj = {} ) const
+        {
+            return rank_order< std::uint32_t >( std::begin(keys), std::end(keys), std::forward<Proj>(proj) );
+        }
+        
+        // cost( key ) of every vertex, by id
+        template <typename Cost>
+        std::vector< double > costs( Cost&& cost ) const
+        {
+            std::vector< double > result( size() );
+            for ( id_type v{0}; v < size(); ++v ) result[v] = static_cast< double >( std::invoke( cost, key(v) ) );
+            return result;
+        }
+        
+        // Bottom level of every vertex, by id - the costliest path from the vertex to a sink, both ends included
+        // One pass in reverse topological order - each row is a max over a contiguous run of successors
+        std::vector< double > bottom_levels( const std::vector< double >& cost ) const
+        {
+            std::vector< double > level( size() );
+            for ( auto v = static_cast< id_type >( size() ); v-- > 0; )
+            {
+                double longest{ 0 };
+                for ( auto k = offsets_[v]; k < offsets_[v + 1]; ++k )
+                    longest = std::max( longest, level[ targets_[k] ] );
+                level[v] = cost[v] + longest;
+            }
+            return level;
+        }
+        std::vector< double > bottom_levels() const { return bottom_levels( vertex_weights_ ); }
+        
+        // List schedule onto a number of identical workers - HLFET, highest bottom level first
+        // Whenever a worker is free the ready vertex with the longest path still ahead of it starts, ties going to the earlier id
+        // Vertices never wait for a free worker while one is idle, and the critical path is started first
+        // Complexity O( (V + E) log V ) - the ready vertices and the running ones are each a binary heap
+        topological_schedule list_schedule( unsigned workers, const std::vector< double >& cost ) const
+        {
+            const auto n = size();
+            const auto level = bottom_levels( cost );
+            
+            topological_schedule result;
+            result.worker.assign( n, 0 );
+            result.start.assign( n, 0 );
+            result.finish.assign( n, 0 );
+            result.sequence.reserve( n );
+            
+            std::vector< id_type > pending( n, 0 );
+            for ( auto w : targets_ ) ++pending[w];
+            
+            auto higher = [&]( id_type a, id_type b ) { return level[a] < level[b] || ( level[a] == level[b] && a > b ); };
+            std::priority_queue< id_type, std::vector< id_type >, decltype(higher) > ready( higher );
+            for ( id_type v{0}; v < n; ++v )
+                if ( pending[v] == 0 ) ready.push( v );
+            
+            using event = std::pair< double, id_type >;     // finish time and vertex
+            std::priority_queue< event, std::vector< event >, std::greater< event > > running;
+            
+            // Free workers - lowest numbered first
+            std::vector< std::uint32_t > idle( std::max( 1u, workers ) );
+            for ( std::uint32_t i{0}; i < idle.size(); ++i ) idle[i] = static_cast< std::uint32_t >( idle.size() - 1 - i );
+            
+            double now{ 0 };
+            while ( !ready.empty() || !running.empty() )
+            {
+                while ( !ready.empty() && !idle.empty() )
+                {
+                    const auto v = ready.top();
+                    ready.pop();
+                    result.worker[v] = idle.back();
+                    idle.pop_back();
+                    result.start[v] = now;
+                    result.finish[v] = now + cost[v];
+                    result.sequence.push_back( v );
+                    running.emplace( result.finish[v], v );
+                }
+                
+                // Advance to the next finish - everything finishing then frees its worker and releases its successors
+                now = running.top().first;
+                result.makespan = std::max( result.makespan, now );
+                while ( !running.empty() && running.top().first <= now )
+                {
+                    const auto v = running.top().second;
+                    running.pop();
+                    idle.push_back( result.worker[v] );
+                    for ( auto k = offsets_[v]; k < offsets_[v + 1]; ++k )
+                        if ( --pending[ targets_[k] ] == 0 ) ready.push( targets_[k] );
+                }
+            }
+            return result;
+        }
+        topological_schedule list_schedule( unsigned workers ) const { return list_schedule( workers, vertex_weights_ ); }
+        
+        // Weight of the heaviest or lightest path ending at each vertex, by id - a path weighs its vertices and its edges
+        // Paths start at any source, or only at from - a vertex that from cannot reach is -infinity for the longest, +infinity for the shortest
+        // One relaxation sweep in topological order - each vertex pulls from its predecessors, a contiguous CSR row, O(V + E)
+        std::vector< double > longest_paths( id_type from = npos ) const     { return relax( from, std::greater<>{} ); }
+        std::vector< double > shortest_paths( id_type from = npos ) const    { return relax( from, std::less<>{} ); }
+        
+        // The keys on the heaviest or lightest path to to - from from, or from any source - empty if there is none
+        std::vector< Key > longest_path( id_type from, id_type to ) const   { return path( longest_paths( from ), from, to, std::greater<>{} ); }
+        std::vector< Key > shortest_path( id_type from, id_type to ) const  { return path( shortest_paths( from ), from, to, std::less<>{} ); }
+        
+        // The heaviest path in the DAG - source to sink, as keys
+        std::vector< Key > critical_path() const
+        {
+            if ( empty() ) return {};
+            const auto distance = longest_paths();
+            const auto to = static_cast< id_type >( std::max_element( distance.begin(), distance.end() ) - distance.begin() );
+            return path( distance, npos, to, std::greater<>{} );
+        }
+        
+        // Earliest and latest start and finish of every vertex, and its slack, given its duration - edge weights are lags, finish to start
+        // A forward pass in id order pulling from the predecessors, then a backward pass in reverse id order pulling from the successors
+        // Flat arrays and contiguous CSR rows throughout, O(V + E)
+        topological_pert pert( const std::vector< double >& duration ) const
+        {
+            const auto n = size();
+            topological_pert result;
+            auto& es = result.earliest_start;
+            auto& ef = result.earliest_finish;
+            auto& ls = result.latest_start;
+            auto& lf = result.latest_finish;
+            es.resize( n );
+            ef.resize( n );
+            ls.resize( n );
+            lf.resize( n );
+            result.slack.resize( n );
+            
+            for ( id_type v{0}; v < n; ++v )
+            {
+                double start{ 0 };
+                for ( auto k = in_offsets_[v]; k < in_offsets_[v + 1]; ++k )
+                    start = std::max( start, ef[ sources_[k] ] + in_weights_[k] );
+                es[v] = start;
+                ef[v] = start + duration[v];
+                result.makespan = std::max( result.makespan, ef[v] );
+            }
+            
+            for ( auto v = static_cast< id_type >( n ); v-- > 0; )
+            {
+                double finish = result.makespan;
+                for ( auto k = offsets_[v]; k < offsets_[v + 1]; ++k )
+                    finish = std::min( finish, ls[ targets_[k] ] - edge_weights_[k] );
+                lf[v] = finish;
+                ls[v] = finish - duration[v];
+                result.slack[v] = ls[v] - es[v];
+            }
+            return result;
+        }
+        topological_pert pert() const { return pert( vertex_weights_ ); }
+        
+        // Every vertex reachable from v, v itself excluded, in id - so topological - order
+        // Only the subgraph below v is touched - ids come off a min-heap, and as successors have higher ids a vertex reached twice comes off twice in a row
+        // So nothing of size V is allocated or cleared - O( (k + e) log e ) for k descendants and the e edges out of v and them
+        std::vector< id_type > descendants( id_type v ) const
+        {
+            return reach( successors(v) );
+        }
+        
+        // Every vertex reachable from any of from, those in from included, in id order - eg what must be recomputed once from have changed
+        // As descendants - the cost is that of the reachable subgraph, not of the DAG
+        std::vector< id_type > reachable( std::span< const id_type > from ) const
+        {
+            return reach( from );
+        }
+        
+        // Level of every vertex, by id - the most edges on a path to it from a source, so every predecessor is on a lower level
+        std::vector< id_type > levels() const
+        {
+            std::vector< id_type > level( size(), 0 );
+            for ( id_type v{0}; v < size(); ++v )
+                for ( auto k = in_offsets_[v]; k < in_offsets_[v + 1]; ++k )
+                    level[v] = std::max( level[v], level[ sources_[k] ] + 1 );
+            return level;
+        }
+        
+        // Dynamic programming over the DAG - state[v] = combine( ... combine( init( v ), state[p0] ) ..., state[pn] ) over the predecessors of v in id order
+        // eg paths from a to every vertex - fold( [&](const auto& key) { return key == a ? 1 : 0; }, std::plus<>{} )
+        // init is a value or a callable taking a key, combine( state, predecessor's state ) returns the new state
+        // The states are one contiguous std::vector by id - T may not be bool, use char
+        // Level by level - each level is split between the threads, which then meet at a barrier, so combine may be called concurrently for different vertices
+        // Levels narrower than parallel_grain run on one thread, together with any narrow levels next to them - a long chain costs no more barriers than a wide level
+        // When no level is that wide no threads are started at all - the fold is the serial sweep, whatever threads says
+        template <typename Init, typename Combine>
+        auto fold( Init&& init, Combine&& combine, unsigned threads = 1 ) const
+        {
+            using T = std::decay_t< decltype( initial_state( init, std::declval< const Key& >() ) ) >;
+            static_assert( !std::is_same_v< T, bool >, "std::vector<bool> is not safe to write from several threads - use char" );
+            
+            std::vector< T > state;
+            state.reserve( size() );
+            for ( id_type v{0}; v < size(); ++v ) state.push_back( initial_state( init, key(v) ) );
+            
+            auto evaluate = [&]( id_type v ) {
+                for ( auto k = in_offsets_[v]; k < in_offsets_[v + 1]; ++k )
+                    state[v] = std::invoke( combine, std::move( state[v] ), std::as_const( state[ sources_[k] ] ) );
+            };
+            
+            // Ids are a topological order - one thread needs nothing else
+            auto sweep = [&] {
+                for ( id_type v{0}; v < size(); ++v ) evaluate( v );
+                return std::move( state );
+            };
+            if ( threads <= 1 ) return sweep();
+            
+            // Vertices by level, counting sort
+            const auto level = levels();
+            const auto depth = size() == 0 ? 0 : *std::max_element( level.begin(), level.end() ) + 1;
+            std::vector< id_type > level_offsets( depth + 1, 0 );
+            for ( auto l : level ) ++level_offsets[l + 1];
+            std::partial_sum( level_offsets.begin(), level_offsets.end(), level_offsets.begin() );
+            std::vector< id_type > by_level( size() );
+            {
+                auto next = level_offsets;
+                for ( id_type v{0}; v < size(); ++v ) by_level[ next[ level[v] ]++ ] = v;
+            }
+            
+            // Phases of by_level - a wide level on its own, to be split, or a run of narrow levels for one thread
+            struct phase { id_type first, last; bool split; };
+            std::vector< phase > phases;
+            for ( id_type l{0}; l < depth; ++l )
+            {
+                const bool split = level_offsets[l + 1] - level_offsets[l] >= parallel_grain;
+                if ( !split && !phases.empty() && !phases.back().split )
+                    phases.back().last = level_offsets[l + 1];
+                else
+                    phases.push_back( { level_offsets[l], level_offsets[l + 1], split } );
+            }
+            
+            // Nothing to split - threads would only wait on thread 0
+            if ( std::none_of( phases.begin(), phases.end(), []( const phase& p ) { return p.split; } ) ) return sweep();
+            
+            std::barrier sync( threads );
+            std::atomic< bool > failed{ false };
+            std::exception_ptr error;
+            
+            auto work = [&]( unsigned t ) {
+                for ( const auto& [first, last, split] : phases )
+                {
+                    if ( !failed.load( std::memory_order_relaxed ) )
+                    {
+                        try
+                        {
+                            if ( split )
+                            {
+                                const auto chunk = ( last - first + threads - 1 ) / threads;
+                                const auto begin = std::min< std::size_t >( last, first + std::size_t{ t } * chunk );
+                                const auto end = std::min< std::size_t >( last, begin + chunk );
+                                for ( auto i = begin; i < end; ++i ) evaluate( by_level[i] );
+                            }
+                            else if ( t == 0 )
+                                for ( auto i = first; i < last; ++i ) evaluate( by_level[i] );
+                        }
+                        catch ( ... )
+                        {
+                            if ( !failed.exchange( true ) ) error = std::current_exception();
+                        }
+                    }
+                    // Everyone keeps meeting, even after a failure, so no thread is left waiting
+                    sync.arrive_and_wait();
+                }
+            };
+            
+            std::vector< std::thread > pool;
+            try
+            {
+                pool.reserve( threads - 1 );
+                for ( unsigned t{1}; t < threads; ++t ) pool.emplace_back( work, t );
+            }
+            catch ( ... )
+            {
+                // The threads already started must still be joined - drop those that never started from the barrier and stop the rest at the next phase
+                if ( !failed.exchange( true ) ) error = std::current_exception();
+                for ( auto t = pool.size() + 1; t < threads; ++t ) sync.arrive_and_drop();
+            }
+            work( 0 );
+            for ( auto& thread : pool ) thread.join();
+            
+            if ( error ) std::rethrow_exception( error );
+            return state;
+        }
+        
+        // Levels at least this wide are split between the threads of a fold
+        static constexpr size_type parallel_grain = 1024;
+        
+    private:
+        // Vertices reachable from the first frontier, in id order - see descendants
+        std::vector< id_type > reach( std::span< const id_type > first ) const
+        {
+            std::priority_queue< id_type, std::vector< id_type >, std::greater< id_type > > frontier( std::greater< id_type >{}, std::vector< id_type >( first.begin(), first.end() ) );
+            
+            std::vector< id_type > result;
+            while ( !frontier.empty() )
+            {
+                const auto w = frontier.top();
+                frontier.pop();
+                if ( !result.empty() && result.back() == w ) continue;
+                result.push_back( w );
+                for ( auto x : successors(w) ) frontier.push( x );
+            }
+            return result;
+        }
+        
+        template <typename Init>
+        static decltype(auto) initial_state( Init& init, const Key& key )
+        {
+            if constexpr ( std::is_invocable_v< Init&, const Key& > )
+                return std::invoke( init, key );
+            else
+                return static_cast< const Init& >( init );
+        }
+        
+        // Best of a vertex's predecessors - branch free, so the row vectorizes
+        template <typename Better>
+        double best_predecessor( const std::vector< double >& distance, id_type v, double worst, Better better ) const
+        {
+            double best = worst;
+            for ( auto k = in_offsets_[v]; k < in_offsets_[v + 1]; ++k )
+            {
+                const double d = distance[ sources_[k] ] + in_weights_[k];
+                best = better( d, best ) ? d : best;
+            }
+            return best;
+        }
+        
+        template <typename Better>
+        static double worst_of( Better better )
+        {
+            constexpr auto infinity = std::numeric_limits< double >::infinity();
+            return better( 0.0, 1.0 ) ? infinity : -infinity;
+        }
+        
+        template <typename Better>
+        std::vector< double > relax( id_type from, Better better ) const
+        {
+            const double worst = worst_of( better );
+            std::vector< double > distance( size(), worst );
+            
+            // Nothing before from can be reached from it
+            for ( id_type v = from == npos ? 0 : from; v < size(); ++v )
+            {
+                const bool start = from == npos ? in_degree(v) == 0 : v == from;
+                const double best = start ? 0.0 : best_predecessor( distance, v, worst, better );
+                distance[v] = best == worst ? worst : best + vertex_weights_[v];
+            }
+            return distance;
+        }
+        
+        // Back from to - at each vertex the predecessor that gave its distance, found again by the same arithmetic
+        template <typename Better>
+        std::vector< Key > path( const std::vector< double >& distance, id_type from, id_type to, Better better ) const
+        {
+            const double worst = worst_of( better );
+            if ( to >= size() || distance[to] == worst ) return {};
+            
+            std::vector< Key > keys;
+            for ( auto v = to;; )
+            {
+                keys.push_back( key(v) );
+                if ( from == npos ? in_degree(v) == 0 : v == from ) break;
+                
+                const double best = best_predecessor( distance, v, worst, better );
+                for ( auto k = in_offsets_[v]; k < in_offsets_[v + 1]; ++k )
+                    if ( distance[ sources_[k] ] + in_weights_[k] == best )
+                    {
+                        v = sources_[k];
+                        break;
+                    }
+            }
+            std::reverse( keys.begin(), keys.end() );
+            return keys;
+        }
+        
+        // The pool the vertices are handles into, if they are - a pool is always there to read, empty if need be
+        const pool_type& pool() const
+        {
+            static const pool_type none{};
+            return pool_ ? *pool_ : none;
+        }
+        
+        std::vector< vertex_type >  vertices_;
+        std::vector< id_type >      offsets_{ 0 };
+        std::vector< id_type >      targets_;
+        std::vector< double >       vertex_weights_;
+        std::vector< double >       edge_weights_;      // parallel to targets_
+        std::vector< id_type >      in_offsets_{ 0 };
+        std::vector< id_type >      sources_;
+        std::vector< double >       in_weights_;        // parallel to sources_
+        std::shared_ptr< const pool_type > pool_;       // null unless the vertices are handles
+        [[no_unique_address]] map_state_type state_;
+        index_type                  index_;
+    };  // class frozen_topological_graph
+
+    //
+    // Incremental scheduling over a frozen DAG - in the spirit of Python's graphlib.TopologicalSorter
+    // get_ready() hands out every vertex whose predecessors are all done, done( v ) releases its successors - O(out-degree)
+    // So work can start on a vertex the moment its last predecessor finishes rather than after the whole sort
+    // fail( v ) skips v and everything downstream of it, walking only what is skipped - no re-sort, no pass over the rest of the DAG
+    // Shares an immutable snapshot - later calls to precede do not affect it, and restarting does not copy it
+    // Not thread safe - drive it from one thread, eg the thread that hands work to a pool
+    //
+
+    template <typename Key, typename Traits>
+    class topological_ready_set
+    {
+    public:
+        using dag_type  = frozen_topological_graph< Key, Traits >;
+        using id_type   = typename dag_type::id_type;
+        using size_type = std::size_t;
+        
+        // Shares the snapshot rather than copying it - eg topological_sorter::prepare hands over its cached one
+        // Throws std::invalid_argument if the DAG has a cycle - the vertices on it would never be ready
+        explicit topological_ready_set( std::shared_ptr< const dag_type > dag ) :
+            dag_( std::move(dag) ), pending_( dag_->size(), 0 ), state_( dag_->size(), waiting )
+        {
+            // Ids are in topological order, so an edge that does not go forward closes a cycle
+            for ( id_type v{0}; v < dag_->size(); ++v )
+                for ( auto w : dag_->successors(v) )
+                {
+                    if ( w <= v ) throw std::invalid_argument( "snicholls::topological_ready_set - the graph has a cycle" );
+                    ++pending_[w];
+                }
+            
+            for ( id_type v{0}; v < dag_->size(); ++v )
+                if ( pending_[v] == 0 ) make_ready( v );
+        }
+        
+        explicit topological_ready_set( dag_type dag ) :
+            topological_ready_set( std::make_shared< const dag_type >( std::move(dag) ) ) {}
+        
+        const dag_type& dag() const { return *dag_; }
+        
+        // Vertices that became ready since the last call - each vertex is handed out exactly once
+        std::vector< id_type > get_ready_ids()
+        {
+            for ( auto v : ready_ ) state_[v] = running;
+            return std::exchange( ready_, {} );
+        }
+        
+        std::vector< Key > get_ready()
+        {
+            std::vector< Key > keys;
+            keys.reserve( ready_.size() );
+            for ( auto v : get_ready_ids() ) keys.push_back( dag_->key(v) );
+            return keys;
+        }
+        
+        // Marks a vertex handed out by get_ready as done - successors whose last predecessor this was become ready
+        // Throws std::invalid_argument if the vertex is not in the DAG, was not handed out or is already done
+        void done_id( id_type v )
+        {
+            if ( v >= state_.size() || state_[v] != running )
+                throw std::invalid_argument( "snicholls::topological_ready_set::done - not a vertex handed out by get_ready" );
+            
+            state_[v] = finished;
+            ++finished_;
+            // A successor cancelled while still waiting stays skipped - its count may reach zero but it is never made ready
+            for ( auto w : dag_->successors(v) )
+                if ( --pending_[w] == 0 && state_[w] != skipped ) make_ready( w );
+        }
+        
+        void done( const Key& key ) { done_id( dag_->id( key ) ); }
+        
+        // A vertex has failed, or is cancelled before it was handed out - it and every vertex depending on it, directly or not, are skipped
+        // Returns the descendants skipped along with it, in topological order - not those skipped already by an earlier failure
+        // Only the newly skipped subgraph is walked - a descendant already skipped is not entered again, O(k + e) for k vertices and their e edges out
+        // Throws std::invalid_argument if the vertex is not in the DAG, is already done or already skipped
+        std::vector< id_type > fail_id( id_type v )
+        {
+            if ( v >= state_.size() || state_[v] == finished || state_[v] == skipped )
+                throw std::invalid_argument( "snicholls::topological_ready_set::fail - not a vertex that is waiting, ready or running" );
+            
+            // Its descendants are all still waiting on it, so only v itself can be among those ready
+            if ( state_[v] == ready ) std::erase( ready_, v );
+            state_[v] = skipped;
+            ++finished_;
+            
+            std::vector< id_type > result;
+            std::vector< id_type > stack( dag_->successors(v).begin(), dag_->successors(v).end() );
+            while ( !stack.empty() )
+            {
+                const auto w = stack.back();
+                stack.pop_back();
+                if ( state_[w] == skipped ) continue;
+                state_[w] = skipped;
+                result.push_back( w );
+                for ( auto x : dag_->successors(w) ) stack.push_back( x );
+            }
+            finished_ += result.size();
+            
+            std::sort( result.begin(), result.end() );
+            return result;
+        }
+        
+        std::vector< Key > fail( const Key& key )
+        {
+            std::vector< Key > keys;
+            for ( auto v : fail_id( dag_->id( key ) ) ) keys.push_back( dag_->key(v) );
+            return keys;
+        }
+        
+        bool is_skipped( id_type v ) const  { return state_[v] == skipped; }
+        
+        // True until every vertex is done or skipped - there may be nothing ready while work is still in progress
+        bool is_active() const  { return finished_ < dag_->size(); }
+        
+        size_type size() const  { return dag_->size(); }
+
+    private:
+        enum state : std::uint8_t { waiting, ready, running, finished, skipped };
+        
+        void make_ready( id_type v )
+        {
+            state_[v] = ready;
+            ready_.push_back( v );
+        }
+        
+        std::shared_ptr< const dag_type >   dag_;
+        std::vector< id_type >              pending_;   // predecessors not yet done
+        std::vector< state >                state_;
+        std::vector< id_type >              ready_;
+        size_type                           finished_{0};   // done or skipped
+    };  // class topological_ready_set
+
+    // Keeps the members it is applied to on separate cache lines - no false sharing between workers
+    inline constexpr std::size_t cache_line_size = 64;
+
+    //
+    // Chase-Lev work stealing deque of trivially copyable values - Le, Pop, Cohen and Zappa Nardelli's version for weak memory models
+    // The owning thread pushes and pops at the bottom, any thread may steal from the top
+    // push is wait-free - a full deque is grown by the owner without waiting - pop and steal are lock-free, they only retry when racing for the last element
+    // The circular array starts at the given capacity, rounded up to a power of two, and the owner doubles it when full
+    // Outgrown arrays are kept until the deque is destroyed - a thief may still be reading one - so memory is at most twice the peak
+    //
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    class work_stealing_deque
+    {
+    public:
+        explicit work_stealing_deque( std::size_t capacity )
+        {
+            arrays_.push_back( std::make_unique< circular_array >( std::bit_ceil( std::max< std::size_t >( capacity, 1 ) ) ) );
+            array_.store( arrays_.back().get(), std::memory_order_relaxed );
+        }
+        
+        work_stealing_deque( const work_stealing_deque& ) = delete;
+        work_stealing_deque& operator=( const work_stealing_deque& ) = delete;
+        
+        // Owner only
+        std::size_t capacity() const { return array_.load( std::memory_order_relaxed )->mask + 1; }
+        
+        // Owner only
+        void push( T x )
+        {
+            const auto b = bottom_.load( std::memory_order_relaxed );
+            const auto t = top_.load( std::memory_order_acquire );
+            auto* a = array_.load( std::memory_order_relaxed );
+            if ( b - t > static_cast< std::int64_t >( a->mask ) ) a = grow( a, t, b );
+            a->slots[ b & a->mask ].store( x, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+            bottom_.store( b + 1, std::memory_order_relaxed );
+        }
+        
+        // Owner only - most recently pushed first
+        std::optional<T> pop()
+        {
+            const auto b = bottom_.load( std::memory_order_relaxed ) - 1;
+            auto* a = array_.load( std::memory_order_relaxed );
+            bottom_.store( b, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            auto t = top_.load( std::memory_order_relaxed );
+            
+            if ( t > b )
+            {
+                bottom_.store( b + 1, std::memory_order_relaxed );
+                return std::nullopt;
+            }
+            
+            const T x = a->slots[ b & a->mask ].load( std::memory_order_relaxed );
+            if ( t == b )
+            {
+                // Last element - race the thieves for it
+                const bool won = top_.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+                bottom_.store( b + 1, std::memory_order_relaxed );
+                if ( !won ) return std::nullopt;
+            }
+            return x;
+        }
+        
+        // Any thread - least recently pushed first
+        // Returns nothing if the deque is empty or another thread took the element first
+        std::optional<T> steal()
+        {
+            auto t = top_.load( std::memory_order_acquire );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            const auto b = bottom_.load( std::memory_order_acquire );
+            if ( t >= b ) return std::nullopt;
+            
+            const auto* a = array_.load( std::memory_order_acquire );
+            const T x = a->slots[ t & a->mask ].load( std::memory_order_relaxed );
+            if ( !top_.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+                return std::nullopt;
+            return x;
+        }
+        
+        // A hint only when other threads are active
+        bool empty() const
+        {
+            return bottom_.load( std::memory_order_relaxed ) <= top_.load( std::memory_order_relaxed );
+        }
+        
+    private:
+        struct circular_array
+        {
+            explicit circular_array( std::size_t n ) : mask( n - 1 ), slots( new std::atomic<T>[n] ) {}
+            
+            std::size_t                         mask;
+            std::unique_ptr< std::atomic<T>[] > slots;
+        };
+        
+        // Owner only - copy [t, b) into an array twice the size and publish it, the old one stays alive for thieves still reading it
+        circular_array* grow( const circular_array* a, std::int64_t t, std::int64_t b )
+        {
+            arrays_.push_back( std::make_unique< circular_array >( 2 * ( a->mask + 1 ) ) );
+            auto* bigger = arrays_.back().get();
+            for ( auto i = t; i < b; ++i )
+                bigger->slots[ i & bigger->mask ].store( a->slots[ i & a->mask ].load( std::memory_order_relaxed ), std::memory_order_relaxed );
+            array_.store( bigger, std::memory_order_release );
+            return bigger;
+        }
+        
+        alignas( cache_line_size ) std::atomic< std::int64_t > top_{0};
+        alignas( cache_line_size ) std::atomic< std::int64_t > bottom_{0};
+        alignas( cache_line_size ) std::atomic< circular_array* > array_;
+        std::vector< std::unique_ptr< circular_array > > arrays_;   // owner only - every array so far, the last is the current one
+    };  // class work_stealing_deque
+
+    //
+    // Thread safe variant of topological_ready_set for a fixed number of workers - no locks anywhere
+    // Each vertex has an atomic count of its predecessors that are not yet done, and each worker its own work_stealing_deque
+    // done_id( v, worker ) decrements the counts of v's successors and pushes those that reach zero onto that worker's deque - wait-free
+    // fail_id( v ) instead skips everything downstream of v - it walks only that subgraph, claiming each vertex with one atomic operation
+    // try_get( worker ) pops from the worker's own deque, most recent first so successors run hot in cache, and otherwise steals from the others
+    // Worker indices are 0 .. workers() - 1 and each must be used by one thread at a time - the deques are single owner
+    // The snapshot is shared, not copied, and the deques grow as needed - setting up costs O(V + E) for the counts and nothing per worker beyond a small deque
+    //
+
+    template <typename Key, typename Traits>
+    class concurrent_ready_set
+    {
+    public:
+        using dag_type  = frozen_topological_graph< Key, Traits >;
+        using id_type   = typename dag_type::id_type;
+        using size_type = std::size_t;
+        using deque_type = work_stealing_deque< id_type >;
+        
+        // Shares the snapshot rather than copying it - eg topological_sorter::prepare_concurrent hands over its cached one
+        // Throws std::invalid_argument if the DAG has a cycle, or there are no workers
+        concurrent_ready_set( std::shared_ptr< const dag_type > dag, unsigned workers ) :
+            dag_( std::move(dag) ), pending_( new std::atomic< id_type >[ dag_->size() ] ), remaining_( dag_->size() )
+        {
+            if ( workers == 0 ) throw std::invalid_argument( "snicholls::concurrent_ready_set - no workers" );
+            
+            for ( id_type v{0}; v < dag_->size(); ++v )
+                for ( auto w : dag_->successors(v) )
+                    if ( w <= v ) throw std::invalid_argument( "snicholls::concurrent_ready_set - the graph has a cycle" );
+            
+            // Deques start small and grow - a worker rarely holds more than a fraction of the vertices at once
+            const auto capacity = std::min< size_type >( dag_->size() / workers + 1, initial_deque_capacity );
+            for ( unsigned i{0}; i < workers; ++i )
+                deques_.push_back( std::make_unique< deque_type >( capacity ) );
+            
+            // Deal the sources out round robin - no other thread can see us yet
+            unsigned next{0};
+            for ( id_type v{0}; v < dag_->size(); ++v )
+            {
+                const auto in_degree = static_cast< id_type >( dag_->in_degree(v) );
+                pending_[v].store( in_degree, std::memory_order_relaxed );
+                if ( in_degree == 0 ) deques_[ next++ % workers ]->push( v );
+            }
+        }
+        
+        concurrent_ready_set( dag_type dag, unsigned workers ) :
+            concurrent_ready_set( std::make_shared< const dag_type >( std::move(dag) ), workers ) {}
+        
+        const dag_type& dag() const     { return *dag_; }
+        unsigned workers() const        { return static_cast< unsigned >( deques_.size() ); }
+        size_type size() const          { return dag_->size(); }
+        
+        // A ready vertex for this worker - its own first, then one stolen from the others
+        // Nothing does not mean we are finished - check is_active()
+        std::optional< id_type > try_get( unsigned worker )
+        {
+            if ( auto v = deques_[worker]->pop() ) return v;
+            
+            const auto n = workers();
+            for ( unsigned i{1}; i < n; ++i )
+                if ( auto v = deques_[ ( worker + i ) % n ]->steal() ) return v;
+            return std::nullopt;
+        }
+        
+        // v has finished - O(out-degree) atomic decrements, each successor whose last predecessor this was goes on the worker's deque
+        // Each vertex must be done exactly once, by the worker that got it or any other
+        // Throws std::invalid_argument if the vertex is not in the DAG - eg done( key ) for a key it does not have - or is already done or skipped
+        void done_id( id_type v, unsigned worker )
+        {
+            if ( v >= dag_->size() || !claim( v, finished ) )
+                throw std::invalid_argument( "snicholls::concurrent_ready_set::done - not a vertex of the DAG that is still to be done" );
+            
+            for ( auto w : dag_->successors(v) )
+                if ( pending_[w].fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+                    deques_[worker]->push( w );
+            remaining_.fetch_sub( 1, std::memory_order_acq_rel );
+        }
+        
+        void done( const Key& key, unsigned worker ) { done_id( dag_->id( key ), worker ); }
+        
+        // v, got from try_get, has failed - instead of done, every vertex depending on it, directly or not, is skipped and never handed out
+        // Returns the descendants skipped, in the order reached - a descendant already skipped by a concurrent or earlier failure is not entered again
+        // Lock free, O(k + e) for the k vertices skipped and their e edges out - a skip is one atomic fetch_or on the pending count
+        // Throws std::invalid_argument if the vertex is not in the DAG, is already done or already skipped
+        std::vector< id_type > fail_id( id_type v )
+        {
+            if ( v >= dag_->size() || !claim( v, skipped ) )
+                throw std::invalid_argument( "snicholls::concurrent_ready_set::fail - not a vertex of the DAG that is still to be done" );
+            
+            std::vector< id_type > result;
+            std::vector< id_type > stack( dag_->successors(v).begin(), dag_->successors(v).end() );
+            while ( !stack.empty() )
+            {
+                const auto w = stack.back();
+                stack.pop_back();
+                if ( pending_[w].fetch_or( skipped, std::memory_order_acq_rel ) & skipped ) continue;
+                result.push_back( w );
+                for ( auto x : dag_->successors(w) ) stack.push_back( x );
+            }
+            remaining_.fetch_sub( result.size() + 1, std::memory_order_acq_rel );
+            return result;
+        }
+        
+        std::vector< Key > fail( const Key& key )
+        {
+            std::vector< Key > keys;
+            for ( auto v : fail_id( dag_->id( key ) ) ) keys.push_back( dag_->key(v) );
+            return keys;
+        }
+        
+        bool is_skipped( id_type v ) const { return pending_[v].load( std::memory_order_acquire ) & skipped; }
+        
+        // True until every vertex is done or skipped
+        bool is_active() const { return remaining_.load( std::memory_order_acquire ) != 0; }
+        
+    private:
+        // Top bit of a pending count - a descendant of a failed vertex always has a predecessor that will never be done
+        // So its count stays above zero, decrements from its other predecessors never reach the bit, and it is never pushed
+        static constexpr id_type skipped = id_type{1} << 31;
+        
+        // Next bit down - set on a vertex once it is done, so it cannot be done or failed again
+        static constexpr id_type finished = id_type{1} << 30;
+        
+        // Sets bit on v unless v is already done or skipped - exactly one done or fail of a vertex wins, before remaining_ or any successor is touched
+        bool claim( id_type v, id_type bit )
+        {
+            auto p = pending_[v].load( std::memory_order_acquire );
+            do
+            {
+                if ( p & ( skipped | finished ) ) return false;
+            }
+            while ( !pending_[v].compare_exchange_weak( p, p | bit, std::memory_order_acq_rel, std::memory_order_acquire ) );
+            return true;
+        }
+        
+        static constexpr size_type initial_deque_capacity = 1024;
+        
+        std::shared_ptr< const dag_type >           dag_;
+        std::unique_ptr< std::atomic< id_type >[] > pending_;   // predecessors not yet done, and the skipped and finished bits
+        std::vector< std::unique_ptr< deque_type > > deques_;
+        alignas( cache_line_size ) std::atomic< size_type > remaining_;
+    };  // class concurrent_ready_set
+
+    // Note: we are NOT checking for cycles
+    // Complexity O(V+E) where V are the number of vertices in the DAG and E is the number of edges
+    // Each step is a lookup in one of the Traits maps - O(log V) for ordered_sorter_traits, O(1) for hashed_sorter_traits and indexed_sorter_traits
+    template <typename Key, typename Traits = default_sorter_traits<Key> >
+    struct topological_sorter
+    {
+        using traits_type = Traits;
+        using stack_type = std::stack< Key >;
+        using visited_type = typename Traits::template map_type< bool >;
+        
+        // The graph is kept over vertices - the keys themselves, or handles into the pool for interned keys
+        using vertex_type = typename Traits::vertex_type;
+        using pool_type = typename Traits::pool_type;
+        // What the maps are built from - eg the Hash and KeyEqual of the container an adapter wraps
+        using map_state_type = typename Traits::map_state_type;
+        // Successors of a vertex - the first few are stored inline, in the adjacency entry itself
+        using successor_list_type = small_vector< vertex_type, inline_successors<vertex_type> >;
+        using adjacency_type = typename Traits::template vertex_map_type< successor_list_type >;
+         
+        // result type for an associative container - std::map, std::unordered_map
+        template <typename T>
+        using associative_sort_type = std::vector< std::pair<const Key, T> >;
+        
+        // result type for std::vector
+        template <typename T>
+        using vector_sort_type = std::vector< T >;
+        
+        // result type for std::array
+        template <typename T, std::size_t N>
+        using array_sort_type = std::array< T, N >;
+        
+        // position of each key in the topological order
+        using rank_type = typename Traits::template map_type< std::size_t >;
+        
+        // row indices of a key column in topological order
+        using permutation_type = std::vector< std::uint32_t >;
+        
+        // immutable snapshot - see freeze()
+        using frozen_type = frozen_topological_graph< Key, Traits >;
+        
+        // incremental scheduling - see prepare()
+        using ready_set_type = topological_ready_set< Key, Traits >;
+        using concurrent_ready_set_type = concurrent_ready_set< Key, Traits >;
+        
+        [[no_unique_address]] map_state_type map_state;
+        adjacency_type adj{ make_map< adjacency_type >() };
+        
+        // Interned keys - shared with the snapshots, so they hold handles rather than copies of the strings
+        // A key first seen while a snapshot still holds the pool goes into a copy of it - a snapshot never sees its pool change
+        // Left empty when the vertices are the keys themselves
+        std::shared_ptr< pool_type > pool;
+        
+        // Optional weights, kept apart from the adjacency - structure of arrays, nothing is allocated until they are used
+        // edge_weights[v][i] is the weight of the edge to adj[v][i] - a shorter list means the rest weigh 0
+        using weight_list_type = small_vector< double, inline_successors<vertex_type> >;
+        typename Traits::template vertex_map_type< weight_list_type > edge_weights{ make_map< typename Traits::template vertex_map_type< weight_list_type > >() };
+        typename Traits::template vertex_map_type< double > vertex_weights{ make_map< typename Traits::template vertex_map_type< double > >() };
+        
+        // Snapshot of the DAG as of the last use - see frozen() - and its order alone as of the last sort - see ordered()
+        // precede drops them, so they are only rebuilt once the DAG has changed - edit adj directly and you must call invalidate()
+        // The snapshot is shared with the concurrent ready sets made from it - see prepare_concurrent
+        std::shared_ptr< const frozen_type > cache;
+        std::optional< frozen_type > order_cache;
+        
+        // Scheduling state - see prepare()
+        std::optional< ready_set_type > schedule;
+        
+        topological_sorter() = default;
+        
+        // Every map - the graph, the ranks and the snapshots - is built from state
+        explicit topological_sorter( map_state_type state ) : map_state( std::move(state) ) {};
+        
+        ~topological_sorter() {};
+        
+        // An empty map of the traits, either kind, built from map_state
+        template <typename Map>
+        Map make_map() const                                        { return Traits::template make_map< Map >( map_state ); }
+        
+        // The vertex of a key - interned if need be - and the key of a vertex
+        vertex_type vertex( const Key& key )
+        {
+            if constexpr ( std::is_empty_v< pool_type > )
+            {
+                pool_type none;
+                return Traits::intern( none, key );
+            }
+            else
+            {
+                if ( !pool )
+                    pool = std::make_shared< pool_type >();
+                else if ( pool.use_count() > 1 && !Traits::find( *pool, key ) )
+                {
+                    // A new key - precede and weigh drop our own snapshots anyway, and anyone else's keeps the pool as it is
+                    invalidate();
+                    if ( pool.use_count() > 1 ) pool = std::make_shared< pool_type >( *pool );
+                }
+                return Traits::intern( *pool, key );
+            }
+        }
+        decltype(auto) key( const vertex_type& vertex ) const
+        {
+            static const pool_type none{};
+            return Traits::key( pool ? *pool : none, vertex );
+        }
+        
+        // Means v must occur before w
+        // Use this method to form the Directed Acyclic Graph ("DAG")
+        // Note that these elements are not automatically inserted into the container - this is by design
+        // The DAG represents a constraint
+        // We cleanly seperate the contents of the container from the constraints that we impose on the container
+        constexpr
+        void precede( Key v, Key w )
+        {
+            auto vw = vertex(w);
+            adj[ vertex(v) ].push_back( vw ); // All w's must come after v
+            invalidate();
+        }
+        
+        // As above with a weight on the edge - eg a lag, or the cost of moving data from v to w
+        void precede( Key v, Key w, double weight )
+        {
+            auto vv = vertex(v);
+            auto vw = vertex(w);
+            auto& successors = adj[vv];
+            auto& weights = edge_weights[vv];
+            while ( weights.size() < successors.size() ) weights.push_back( 0 );
+            successors.push_back( vw );
+            weights.push_back( weight );
+            invalidate();
+        }
+        
+        // Weight of a vertex - eg its duration
+        // A key not yet mentioned to precede becomes a vertex of its own, with no edges - a job that depends on nothing still counts
+        void weigh( Key key, double weight )
+        {
+            auto v = vertex(key);
+            adj.try_emplace( v );
+            vertex_weights[v] = weight;
+            invalidate();
+        }
+        
+        // Note that this is non-const - it is by design for use cases where we repeatedly call topological_sort
+        // The depth first search is only rerun if precede has been called since the last sort - otherwise this is a copy of the cached order
+        stack_type topological_sort()
+        {
+            return ordered().topological_sort();
+        }
+        
+        // Keys in topological order and their ranks, without the edges - what a sort needs and no more
+        // Built on first use after a precede and reused by every sort until the next one - the full snapshot is used instead if there is one
+        // All the sorts below, and the adapters, go through here - so sorting repeatedly against an unchanged DAG costs no more depth first searches
+        const frozen_type& ordered()
+        {
+            if ( cache ) return *cache;
+            if ( !order_cache )
+            {
+                auto position = make_map< position_type >();
+                auto post = post_order( position );
+                order_cache.emplace( std::vector< vertex_type >( post.rbegin(), post.rend() ), map_state, pool );
+            }
+            return *order_cache;
+        }
+        
+        // The DAG as it stands, frozen with its edges and weights - built on first use after a precede and reused until the next one
+        // Scheduling, paths and folds go through here
+        const frozen_type& frozen()
+        {
+            if ( !cache )
+            {
+                cache = std::make_shared< const frozen_type >( freeze() );
+                order_cache.reset();
+            }
+            return *cache;
+        }
+        
+        // Drops the cached order and snapshot - precede and weigh call this, edit adj directly and you must call it yourself
+        void invalidate()
+        {
+            cache.reset();
+            order_cache.reset();
+        }
+        
+        // Immutable snapshot of the DAG for repeated sorting - CSR arrays, dense ids, topological order and ranks all computed once
+        // Later calls to precede do not affect the snapshot
+        // The depth first search is iterative here, so freezing very deep DAGs is safe, and gives the same order as topological_sort
+        frozen_type freeze() const
+        {
+            using id_type = typename frozen_type::id_type;
+            
+            auto position = make_map< position_type >();
+            const auto post = post_order( position );
+            
+            // Ids are positions in the topological order - the reverse of the post order
+            const auto n = static_cast< id_type >( post.size() );
+            auto id_of = [&]( const vertex_type& v ) { return static_cast< id_type >( n - 1 - position.find(v)->second ); };
+            
+            std::vector< vertex_type > vertices( post.rbegin(), post.rend() );
+            
+            std::vector< id_type > offsets( n + 1, 0 );
+            std::vector< id_type > targets;
+            std::vector< double > weights( n, 0 );
+            std::vector< double > edge_weight;
+            const weight_list_type unweighted{};
+            for ( id_type i{0}; i < n; ++i )
+            {
+                const auto& v = post[n - 1 - i];
+                if ( auto it = vertex_weights.find(v); it != vertex_weights.end() ) weights[i] = it->second;
+                
+                auto row = edge_weights.find(v);
+                const auto& row_weights = row == edge_weights.end() ? unweighted : row->second;
+                
+                if ( auto it = adj.find(v); it != adj.end() )
+                {
+                    const auto& successors = it->second;
+                    for ( std::size_t k{0}; k < successors.size(); ++k )
+                    {
+                        targets.push_back( id_of( successors[k] ) );
+                        edge_weight.push_back( k < row_weights.size() ? row_weights[k] : 0.0 );
+                    }
+                }
+                offsets[i + 1] = static_cast< id_type >( targets.size() );
+            }
+            
+            return frozen_type( std::move(vertices), std::move(offsets), std::move(targets), std::move(weights), std::move(edge_weight), map_state, pool );
+        }
+        
+        // Position of each vertex in the post order - see post_order
+        using position_type = typename Traits::template vertex_map_type< std::uint32_t >;
+        
+        // Post order of the vertices - the reverse of the topological order, each vertex placed once all its successors have been
+        // Iterative, so very deep DAGs are safe - each vertex's successor list is looked up once, when it is entered
+        // position doubles as the visited flags and is left holding the index of every vertex in the result
+        std::vector< vertex_type > post_order( position_type& position ) const
+        {
+            constexpr auto entered = ~std::uint32_t{0};
+            
+            std::vector< vertex_type > post;
+            const successor_list_type none{};
+            
+            // Vertex, its successors and the index of the next one to visit
+            struct frame { vertex_type v; const successor_list_type* successors; std::size_t next; };
+            std::vector< frame > path;
+            auto enter = [&]( const vertex_type& v ) {
+                position.try_emplace( v, entered );
+                auto it = adj.find(v);
+                path.push_back( { v, it == adj.end() ? &none : &it->second, 0 } );
+            };
+            
+            for ( const auto& [root, ignore] : adj )
+            {
+                if ( position.find( root ) != position.end() ) continue;
+                enter( root );
+                
+                while ( !path.empty() )
+                {
+                    auto& top = path.back();
+                    if ( top.next < top.successors->size() )
+                    {
+                        const auto w = (*top.successors)[ top.next++ ];
+                        if ( position.find( w ) == position.end() ) enter( w );
+                    }
+                    else
+                    {
+                        position.find( top.v )->second = static_cast< std::uint32_t >( post.size() );
+                        post.push_back( top.v );
+                        path.pop_back();
+                    }
+                }
+            }
+            return post;
+        }
+        
+        // Incremental scheduling - eg
+        //      g.prepare();
+        //      while ( g.is_active() ) { for ( auto& key : g.get_ready() ) submit( key ); g.done( wait_for_any() ); }
+        // prepare() freezes the in-degrees - later calls to precede do not affect a schedule in progress, call prepare() again to restart
+        // Throws std::invalid_argument if the DAG has a cycle
+        void prepare()                          { frozen(); schedule.emplace( cache ); }
+        
+        // Keys whose predecessors are all done and that have not been handed out before
+        std::vector< Key > get_ready()          { return prepared().get_ready(); }
+        
+        // The key has finished - O(out-degree)
+        void done( const Key& key )             { prepared().done( key ); }
+        
+        // The key has failed, or is cancelled - it and every key depending on it are dropped from the schedule
+        // Returns the keys dropped along with it, in topological order - the cost is proportional to what is dropped
+        std::vector< Key > fail( const Key& key )   { return prepared().fail( key ); }
+        
+        bool is_active()                        { return prepared().is_active(); }
+        
+        // Static schedule of the DAG onto a number of workers given the cost of each key - see frozen_topological_graph::list_schedule
+        // The ids in the result are those of frozen() - eg g.frozen().key( schedule.sequence.front() )
+        template <typename Cost>
+        topological_schedule list_schedule( unsigned workers, Cost&& cost )
+        {
+            const auto& dag = frozen();
+            return dag.list_schedule( workers, dag.costs( std::forward<Cost>(cost) ) );
+        }
+        
+        // As above with the weights given to weigh as the costs
+        topological_schedule list_schedule( unsigned workers )  { return frozen().list_schedule( workers ); }
+        
+        // Heaviest path through the DAG, as keys - by the weights given to weigh and precede( v, w, weight )
+        std::vector< Key > critical_path()                      { return frozen().critical_path(); }
+        
+        // Earliest and latest starts and slack of every vertex - see frozen_topological_graph::pert
+        // Durations are the weights given to weigh, or duration( key ), lags the edge weights - ids are those of frozen()
+        topological_pert pert()                                 { return frozen().pert(); }
+        
+        template <typename Duration>
+        topological_pert pert( Duration&& duration )
+        {
+            const auto& dag = frozen();
+            return dag.pert( dag.costs( std::forward<Duration>(duration) ) );
+        }
+        
+        // Dynamic programming over the DAG in topological order - see frozen_topological_graph::fold
+        // Returns the state of every vertex by the ids of frozen() - eg state[ g.frozen().id( key ) ]
+        // One thread unless told otherwise, as for the frozen graph - eg std::thread::hardware_concurrency() for a large, wide DAG
+        template <typename Init, typename Combine>
+        auto fold( Init&& init, Combine&& combine, unsigned threads = 1 )
+        {
+            return frozen().fold( std::forward<Init>(init), std::forward<Combine>(combine), threads );
+        }
+        
+        // Every key depending on key, directly or not, in topological order - what a failure of key takes with it
+        // Only that part of the DAG is walked - empty if key is not in the DAG
+        std::vector< Key > descendants( const Key& key )
+        {
+            const auto& dag = frozen();
+            std::vector< Key > keys;
+            if ( dag.contains( key ) )
+                for ( auto v : dag.descendants( dag.id( key ) ) ) keys.push_back( dag.key(v) );
+            return keys;
+        }
+        
+        // Keys to recompute once changed have changed - the changed keys and every key depending on them, in topological order
+        // Ranks come from the cached snapshot and only the affected part of the DAG is walked, so the cost follows the size of the change
+        // Changed keys that are not in the DAG are ignored
+        template <typename Range>
+        std::vector< Key > affected_order( const Range& changed )
+        {
+            const auto& dag = frozen();
+            std::vector< typename frozen_type::id_type > from;
+            for ( const auto& key : changed )
+                if ( auto v = dag.id( key ); v != dag.npos ) from.push_back( v );
+            
+            std::vector< Key > keys;
+            for ( auto v : dag.reachable( from ) ) keys.push_back( dag.key(v) );
+            return keys;
+        }
+        
+        std::vector< Key > affected_order( std::initializer_list< Key > changed ) { return affected_order< std::initializer_list< Key > >( changed ); }
+        
+        // Heaviest and lightest paths from one key to another - empty if there is no path
+        std::vector< Key > longest_path( const Key& from, const Key& to )
+        {
+            const auto& dag = frozen();
+            return dag.contains( from ) ? dag.longest_path( dag.id( from ), dag.id( to ) ) : std::vector< Key >{};
+        }
+        std::vector< Key > shortest_path( const Key& from, const Key& to )
+        {
+            const auto& dag = frozen();
+            return dag.contains( from ) ? dag.shortest_path( dag.id( from ), dag.id( to ) ) : std::vector< Key >{};
+        }
+        
+        // Lock free ready set for a pool of workers over the DAG as it stands - see concurrent_ready_set
+        // The ready set shares the cached snapshot - nothing is copied, and a later precede leaves the ready set's snapshot alive
+        concurrent_ready_set_type prepare_concurrent( unsigned workers )
+        {
+            frozen();
+            return concurrent_ready_set_type( cache, workers );
+        }
+        
+        // Throws std::logic_error if prepare() has not been called
+        ready_set_type& prepared()
+        {
+            if ( !schedule ) throw std::logic_error( "snicholls::topological_sorter - prepare() has not been called" );
+            return *schedule;
+        }
+        
+        // Position of each key of the DAG in the topological order - 0 is first
+        rank_type topological_rank()
+        {
+            const auto& order = ordered().order();
+            
+            auto rank = make_map< rank_type >();
+            for ( std::size_t index{0}; index < order.size(); ++index )
+                rank.try_emplace( order[index], index );
+            return rank;
+        }
+        
+        // Stable ordering of the elements [first,last) according to the rank of proj(element)
+        // Returns the positions of the elements relative to first in sorted order
+        // Keys that are not in the DAG are placed last, in order of first appearance - same rule as the adapters
+        // Complexity O(N + V + E) plus a rank lookup per element - a counting sort over the ranks, so equal keys keep their relative order
+        template <typename Index = std::size_t, typename ForwardIt, typename Proj>
+        std::vector< Index > rank_order( ForwardIt first, ForwardIt last, Proj&& proj )
+        {
+            return ordered().template rank_order< Index >( first, last, std::forward<Proj>(proj) );
+        }
+        
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+        // As above - the rank of every element is looked up under the execution policy, eg std::execution::par_unseq
+        // Only the elements whose keys are not in the DAG take a second, serial, pass so that they are ranked in order of first appearance
+        template <typename ExecutionPolicy, typename ForwardIt, typename Proj>
+            requires std::is_execution_policy_v< std::remove_cvref_t<ExecutionPolicy> >
+        std::vector< std::size_t > rank_order( ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, Proj&& proj )
+        {
+            const auto& dag = ordered();
+            auto next = dag.size();
+            constexpr auto unranked = ~std::size_t{0};
+            
+            // Lookups only - the snapshot is immutable, so concurrent lookups are safe
+            std::vector< std::size_t > ranks( static_cast< std::size_t >( std::distance( first, last ) ) );
+            std::transform( policy, first, last, ranks.begin(),
+                           [&](const auto& x) {
+                auto r = dag.id( std::invoke( proj, x ) );
+                return r == dag.npos ? unranked : std::size_t{ r };
+                           } );
+            
+            // Keys not in the DAG
+            auto rank = make_map< rank_type >();
+            auto it = first;
+            for ( auto& r : ranks )
+            {
+                if ( r == unranked )
+                {
+                    auto [pos, inserted] = rank.try_emplace( std::invoke( proj, *it ), next );
+                    if ( inserted ) ++next;
+                    r = pos->second;
+                }
+                ++it;
+            }
+            
+            return detail::counting_order< std::size_t >( ranks, next );
+        }
+        
+        // Result for an associative container - std::map, std::unordered_map - under the execution policy
+        // The DAG keys are found in the container and the container's elements are checked against the DAG in parallel
+        // Keys in the DAG but not in the container are ignored, the rest go last in container order
+        template <typename T, typename ExecutionPolicy, typename Container>
+            requires std::is_execution_policy_v< std::remove_cvref_t<ExecutionPolicy> >
+        associative_sort_type<T> associative_sort( ExecutionPolicy&& policy, const Container& c )
+        {
+            const auto& dag = ordered();
+            
+            // DAG keys in topological order - found by id, so interned keys are read straight out of the pool
+            std::vector< typename Container::const_iterator > found( dag.size() );
+            std::for_each( policy, found.begin(), found.end(), [&](auto& it) {
+                it = c.find( dag.key( static_cast< typename frozen_type::id_type >( &it - found.data() ) ) );
+            } );
+            
+            std::vector< const typename Container::value_type* > elements;
+            elements.reserve( c.size() );
+            for ( const auto& element : c ) elements.push_back( &element );
+            
+            std::vector< char > in_dag( elements.size() );
+            std::transform( policy, elements.begin(), elements.end(), in_dag.begin(), [&](const auto* element) { return dag.contains( element->first ); } );
+            
+            // Copy out in order
+            associative_sort_type<T> result;
+            result.reserve( c.size() );
+            for ( auto it : found )
+                if ( it != c.end() ) result.emplace_back( *it );
+            for ( std::size_t i{0}; i < elements.size(); ++i )
+                if ( !in_dag[i] ) result.emplace_back( *elements[i] );
+            return result;
+        }
+#endif
+        
+        // Topological order of a column of keys as a permutation of its indices - result[i] is the row that goes i'th
+        // Use with apply_permutation above to reorder any number of parallel columns ( structure of arrays ) in lockstep
+        // Columns are limited to 2^32 rows
+        template <typename Range, typename Proj = std::identity>
+        permutation_type permutation( const Range& keys, Proj&& proj = {} )
+        {
+            return ordered().permutation( keys, std::forward<Proj>(proj) );
+        }
+    };
+
+    //
+    // Runs work in dependency order on a fixed pool of threads - eg
+    //      snicholls::topological_executor pool;
+    //      pool.run( g, [&](const auto& key) { build( key ); } );
+    // A vertex starts as soon as its last predecessor has finished - scheduling is a concurrent_ready_set, so there are no locks per vertex
+    // Work is either a callable taking a key or a mapping from keys to callables, eg std::map< Key, std::function<void()> >
+    // DAG keys with no entry in a mapping are skipped - their successors still wait for them
+    // The calling thread is worker 0 and takes part - the pool starts size() - 1 threads once and reuses them for every run
+    // If work throws the remaining vertices are abandoned, and run rethrows the first exception once every worker has stopped
+    //
+
+    class topological_executor
+    {
+    public:
+        explicit topological_executor( unsigned threads = std::max( 1u, std::thread::hardware_concurrency() ) ) :
+            size_( std::max( 1u, threads ) )
+        {
+            for ( unsigned worker{1}; worker < size_; ++worker )
+                threads_.emplace_back( [this, worker] { serve( worker ); } );
+        }
+        
+        topological_executor( const topological_executor& ) = delete;
+        topological_executor& operator=( const topological_executor& ) = delete;
+        
+        ~topological_executor()
+        {
+            {
+                std::lock_guard lock( mutex_ );
+                stop_ = true;
+            }
+            start_.notify_all();
+            for ( auto& t : threads_ ) t.join();
+        }
+        
+        unsigned size() const { return size_; }
+        
+        // Runs every vertex of the DAG as it stands - one run at a time per executor
+        template <typename Key, typename Traits, typename Work>
+        void run( topological_sorter< Key, Traits >& g, Work&& work )
+        {
+            run( g.frozen(), std::forward<Work>(work) );
+        }
+        
+        // The DAG is only borrowed - it is not copied, so setting up a run costs O(V + E) for the counts and no more
+        template <typename Key, typename Traits, typename Work>
+        void run( const frozen_topological_graph< Key, Traits >& dag, Work&& work )
+        {
+            // Non-owning - an empty owner aliased to dag, which outlives the run
+            std::shared_ptr< const frozen_topological_graph< Key, Traits > > borrowed( std::shared_ptr< void >(), &dag );
+            concurrent_ready_set< Key, Traits > ready( std::move(borrowed), size_ );
+            std::atomic< bool > failed{ false };
+            std::exception_ptr error;
+            
+            // The only type erased call is one per worker per run - never per vertex
+            dispatch( [&]( unsigned worker ) {
+                unsigned idle{0};
+                while ( ready.is_active() && !failed.load( std::memory_order_relaxed ) )
+                {
+                    auto v = ready.try_get( worker );
+                    if ( !v )
+                    {
+                        // Back off - spin briefly while the stragglers finish, then give up the core
+                        if ( ++idle > spin_limit ) std::this_thread::yield();
+                        continue;
+                    }
+                    idle = 0;
+                    
+                    try
+                    {
+                        execute( work, ready.dag().key( *v ) );
+                    }
+                    catch ( ... )
+                    {
+                        if ( !failed.exchange( true ) ) error = std::current_exception();
+                        return;
+                    }
+                    ready.done_id( *v, worker );
+                }
+            } );
+            
+            if ( error ) std::rethrow_exception( error );
+        }
+        
+    private:
+        static constexpr unsigned spin_limit = 64;
+        
+        template <typename Work, typename Key>
+        static void execute( Work& work, const Key& key )
+        {
+            if constexpr ( std::is_invocable_v< Work&, const Key& > )
+                std::invoke( work, key );
+            else
+            {
+                // A mapping from keys to callables
+                if ( auto it = work.find( key ); it != work.end() )
+                    std::invoke( it->second );
+            }
+        }
+        
+        // Runs job( worker ) on every worker, this thread included, and waits for them all
+        void dispatch( std::function< void(unsigned) > job )
+        {
+            {
+                std::lock_guard lock( mutex_ );
+                job_ = std::move( job );
+                busy_ = size_ - 1;
+                ++generation_;
+            }
+            start_.notify_all();
+            
+            job_( 0 );
+            
+            std::unique_lock lock( mutex_ );
+            finished_.wait( lock, [this] { return busy_ == 0; } );
+            job_ = nullptr;
+        }
+        
+        void serve( unsigned worker )
+        {
+            std::size_t seen{0};
+            for (;;)
+            {
+                {
+                    std::unique_lock lock( mutex_ );
+                    start_.wait( lock, [&] { return stop_ || generation_ != seen; } );
+                    if ( stop_ ) return;
+                    seen = generation_;
+                }
+                
+                job_( worker );
+                
+                std::lock_guard lock( mutex_ );
+                if ( --busy_ == 0 ) finished_.notify_one();
+            }
+        }
+        
+        unsigned                            size_;
+        std::vector< std::thread >          threads_;
+        std::mutex                          mutex_;
+        std::condition_variable             start_;
+        std::condition_variable             finished_;
+        std::function< void(unsigned) >     job_;
+        std::size_t                         generation_{0};
+        unsigned                            busy_{0};
+        bool                                stop_{false};
+    };  // class topological_executor
+
+#if SNICHOLLS_TOPOLOGICAL_COROUTINES
+    //
+    // A vertex as a coroutine - the work for a key returns one of these, eg
+    //      snicholls::topological_task fetch( snicholls::topological_async_executor& ex, int fd ) { co_await ex.readable( fd ); ... }
+    // Created suspended - the executor starts it once its predecessors have finished, and it finishes when the coroutine returns
+    // So a vertex waiting on I/O holds no thread, only its coroutine frame
+    //
+
+    class topological_task
+    {
+    public:
+        struct promise_type
+        {
+            using finish_type = void (*)( void* context, std::uint32_t id, std::exception_ptr error );
+            
+            topological_task get_return_object() { return topological_task( std::coroutine_handle< promise_type >::from_promise( *this ) ); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            
+            // Tells the executor and frees the frame - the coroutine is suspended here so it may destroy itself
+            struct final_awaiter
+            {
+                bool await_ready() noexcept { return false; }
+                void await_suspend( std::coroutine_handle< promise_type > h ) noexcept
+                {
+                    auto& p = h.promise();
+                    auto finish = p.finish;
+                    auto context = p.context;
+                    auto id = p.id;
+                    auto error = std::move( p.error );
+                    h.destroy();
+                    if ( finish ) finish( context, id, std::move( error ) );
+                }
+                void await_resume() noexcept {}
+            };
+            final_awaiter final_suspend() noexcept { return {}; }
+            
+            void return_void() {}
+            void unhandled_exception() { error = std::current_exception(); }
+            
+            finish_type         finish{ nullptr };
+            void*               context{ nullptr };
+            std::uint32_t       id{ 0 };
+            std::exception_ptr  error;
+        };
+        
+        using handle_type = std::coroutine_handle< promise_type >;
+        
+        topological_task( topological_task&& other ) noexcept : h( std::exchange( other.h, {} ) ) {}
+        topological_task& operator=( topological_task&& other ) noexcept
+        {
+            if ( this != &other )
+            {
+                if ( h ) h.destroy();
+                h = std::exchange( other.h, {} );
+            }
+            return *this;
+        }
+        
+        // A task that was never started is freed here
+        ~topological_task() { if ( h ) h.destroy(); }
+        
+        // The executor takes over the coroutine
+        handle_type release() { return std::exchange( h, {} ); }
+        
+    private:
+        explicit topological_task( handle_type h ) : h( h ) {}
+        
+        handle_type h;
+    };  // class topological_task
+
+    //
+    // Runs a DAG of coroutines on a handful of threads - many thousands of vertices can be in flight at once
+    //      snicholls::topological_async_executor ex( 4 );
+    //      ex.run( g, [&](const auto& key) -> snicholls::topological_task { co_await ex.readable( fd_of( key ) ); ... } );
+    // A vertex is started the moment its last predecessor finishes - in-degrees are atomic counters, as for concurrent_ready_set
+    // Coroutines run on the worker threads, co_await schedule() moves one to the back of the queue
+    // On Linux co_await readable( fd ) / writable( fd ) parks a coroutine in the bundled epoll loop until the descriptor is ready
+    // eg a subprocess - co_await readable( pidfd_open( pid, 0 ) ) resumes once it has exited
+    // If a task throws no more vertices are started, and run rethrows the first exception once those in flight have finished
+    // The run queue is a mutex and a std::deque - a resume costs a lock, which suits I/O bound vertices, use topological_executor for fine grained CPU work
+    //
+
+    class topological_async_executor
+    {
+    public:
+        explicit topological_async_executor( unsigned threads = std::max( 1u, std::thread::hardware_concurrency() ) )
+        {
+#if SNICHOLLS_TOPOLOGICAL_EPOLL
+            epoll_ = ::epoll_create1( EPOLL_CLOEXEC );
+            if ( epoll_ < 0 ) throw std::system_error( errno, std::system_category(), "snicholls::topological_async_executor - epoll_create1" );
+            wake_ = ::eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+            if ( wake_ < 0 )
+            {
+                ::close( epoll_ );
+                throw std::system_error( errno, std::system_category(), "snicholls::topological_async_executor - eventfd" );
+            }
+            epoll_event e{};
+            e.events = EPOLLIN;
+            e.data.ptr = nullptr;
+            ::epoll_ctl( epoll_, EPOLL_CTL_ADD, wake_, &e );
+            loop_ = std::thread( [this] { poll(); } );
+#endif
+            for ( unsigned i{0}; i < std::max( 1u, threads ); ++i )
+                threads_.emplace_back( [this] { serve(); } );
+        }
+        
+        topological_async_executor( const topological_async_executor& ) = delete;
+        topological_async_executor& operator=( const topological_async_executor& ) = delete;
+        
+        ~topological_async_executor()
+        {
+            {
+                std::lock_guard lock( mutex_ );
+                stop_ = true;
+            }
+            ready_.notify_all();
+            for ( auto& t : threads_ ) t.join();
+#if SNICHOLLS_TOPOLOGICAL_EPOLL
+            std::uint64_t one{1};
+            [[maybe_unused]] auto n = ::write( wake_, &one, sizeof(one) );
+            loop_.join();
+            ::close( wake_ );
+            ::close( epoll_ );
+#endif
+        }
+        
+        // Runs every vertex of the DAG as it stands and waits for them all - one run at a time per executor
+        // work( key ) returns the topological_task for the key
+        template <typename Key, typename Traits, typename Work>
+        void run( topological_sorter< Key, Traits >& g, Work&& work )
+        {
+            run( g.frozen(), std::forward<Work>(work) );
+        }
+        
+        template <typename Key, typename Traits, typename Work>
+        void run( const frozen_topological_graph< Key, Traits >& dag, Work&& work )
+        {
+            using id_type = typename frozen_topological_graph< Key, Traits >::id_type;
+            
+            run_state state;
+            state.successors = [&]( id_type v ) { return dag.successors( v ); };
+            state.make = [&]( id_type v ) { return std::invoke( work, dag.key( v ) ); };
+            state.pending.reset( new std::atomic< id_type >[ dag.size() ] );
+            state.remaining = dag.size();
+            state.ex = this;
+            
+            // Ids are in topological order, so an edge that does not go forward closes a cycle
+            std::vector< id_type > in_degree( dag.size(), 0 );
+            for ( id_type v{0}; v < dag.size(); ++v )
+                for ( auto w : dag.successors( v ) )
+                {
+                    if ( w <= v ) throw std::invalid_argument( "snicholls::topological_async_executor - the graph has a cycle" );
+                    ++in_degree[w];
+                }
+            
+            std::vector< id_type > sources;
+            for ( id_type v{0}; v < dag.size(); ++v )
+            {
+                state.pending[v].store( in_degree[v], std::memory_order_relaxed );
+                if ( in_degree[v] == 0 ) sources.push_back( v );
+            }
+            
+            for ( auto v : sources ) start( state, v );
+            
+            std::unique_lock lock( state.mutex );
+            state.finished.wait( lock, [&] { return state.in_flight == 0 && ( state.remaining == 0 || state.failed ); } );
+            if ( state.error ) std::rethrow_exception( state.error );
+        }
+        
+        // co_await ex.schedule() - suspends and requeues the coroutine on the pool, eg to yield in a long computation
+        auto schedule()
+        {
+            struct awaiter
+            {
+                topological_async_executor* ex;
+                bool await_ready() const noexcept { return false; }
+                void await_suspend( std::coroutine_handle<> h ) { ex->post( h ); }
+                void await_resume() const noexcept {}
+            };
+            return awaiter{ this };
+        }
+        
+#if SNICHOLLS_TOPOLOGICAL_EPOLL
+        // co_await ex.readable( fd ) - resumes on the pool once fd is readable, or has hung up or failed
+        // One coroutine per descriptor at a time - the registration is one shot and left in place for the next wait, closing the descriptor removes it
+        auto readable( int fd ) { return io_awaiter{ this, fd, EPOLLIN }; }
+        auto writable( int fd ) { return io_awaiter{ this, fd, EPOLLOUT }; }
+#endif
+        
+    private:
+        // State of one run - vertices are ids in the frozen DAG
+        struct run_state
+        {
+            std::function< std::span< const std::uint32_t >( std::uint32_t ) > successors;
+            std::function< topological_task( std::uint32_t ) > make;
+            std::unique_ptr< std::atomic< std::uint32_t >[] > pending;   // predecessors not yet finished
+            
+            std::mutex              mutex;
+            std::condition_variable finished;
+            std::size_t             remaining{0};   // guarded by mutex - only touched once per vertex
+            std::size_t             in_flight{0};
+            bool                    failed{ false };
+            std::exception_ptr      error;
+            topological_async_executor* ex{ nullptr };
+        };
+        
+        void start( run_state& state, std::uint32_t v )
+        {
+            {
+                std::lock_guard lock( state.mutex );
+                if ( state.failed ) return;
+                ++state.in_flight;
+            }
+            
+            typename topological_task::handle_type h;
+            try
+            {
+                h = state.make( v ).release();
+            }
+            catch ( ... )
+            {
+                fail( state, std::current_exception() );
+                std::lock_guard lock( state.mutex );
+                if ( --state.in_flight == 0 ) state.finished.notify_all();
+                return;
+            }
+            
+            auto& p = h.promise();
+            p.finish = &finish;
+            p.context = &state;
+            p.id = v;
+            post( h );
+        }
+        
+        static void fail( run_state& state, std::exception_ptr error )
+        {
+            std::lock_guard lock( state.mutex );
+            if ( !state.failed )
+            {
+                state.failed = true;
+                state.error = std::move( error );
+            }
+        }
+        
+        // A task has returned - release its successors
+        static void finish( void* context, std::uint32_t v, std::exception_ptr error )
+        {
+            auto& state = *static_cast< run_state* >( context );
+            if ( error )
+                fail( state, std::move( error ) );
+            else
+                for ( auto w : state.successors( v ) )
+                    if ( state.pending[w].fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+                        state.ex->start( state, w );
+            
+            // Last, since the run - and so state - may end as soon as this is seen
+            std::lock_guard lock( state.mutex );
+            --state.remaining;
+            if ( --state.in_flight == 0 && ( state.remaining == 0 || state.failed ) )
+                state.finished.notify_all();
+        }
+        
+        void post( std::coroutine_handle<> h )
+        {
+            {
+                std::lock_guard lock( mutex_ );
+                queue_.push_back( h );
+            }
+            ready_.notify_one();
+        }
+        
+        void serve()
+        {
+            for (;;)
+            {
+                std::coroutine_handle<> h;
+                {
+                    std::unique_lock lock( mutex_ );
+                    ready_.wait( lock, [this] { return stop_ || !queue_.empty(); } );
+                    if ( queue_.empty() ) return;
+                    h = queue_.front();
+                    queue_.pop_front();
+                }
+                h.resume();
+            }
+        }
+        
+#if SNICHOLLS_TOPOLOGICAL_EPOLL
+        struct io_awaiter
+        {
+            topological_async_executor* ex;
+            int fd;
+            std::uint32_t events;
+            
+            bool await_ready() const noexcept { return false; }
+            
+            // Nothing here may be touched after epoll_ctl - the coroutine can be resumed on another thread straight away
+            void await_suspend( std::coroutine_handle<> h )
+            {
+                epoll_event e{};
+                e.events = events | EPOLLONESHOT;
+                e.data.ptr = h.address();
+                if ( ::epoll_ctl( ex->epoll_, EPOLL_CTL_MOD, fd, &e ) == 0 ) return;
+                if ( errno == ENOENT && ::epoll_ctl( ex->epoll_, EPOLL_CTL_ADD, fd, &e ) == 0 ) return;
+                throw std::system_error( errno, std::system_category(), "snicholls::topological_async_executor - epoll_ctl" );
+            }
+            void await_resume() const noexcept {}
+        };
+        
+        // The event loop - hands each coroutine whose descriptor is ready back to the pool
+        void poll()
+        {
+            std::array< epoll_event, 64 > events;
+            for (;;)
+            {
+                const int n = ::epoll_wait( epoll_, events.data(), static_cast<int>( events.size() ), -1 );
+                if ( n < 0 )
+                {
+                    if ( errno == EINTR ) continue;
+                    return;
+                }
+                for ( int i{0}; i < n; ++i )
+                {
+                    if ( events[i].data.ptr == nullptr ) return;    // woken by the destructor
+                    post( std::coroutine_handle<>::from_address( events[i].data.ptr ) );
+                }
+            }
+        }
+        
+        int             epoll_{ -1 };
+        int             wake_{ -1 };
+        std::thread     loop_;
+#endif
+        
+        std::vector< std::thread >              threads_;
+        std::mutex                              mutex_;
+        std::condition_variable                 ready_;
+        std::deque< std::coroutine_handle<> >   queue_;
+        bool                                    stop_{ false };
+    };  // class topological_async_executor
+#endif
+
+    //
+    // Associative containers
+    //
+    // std::map - drop in replacement
+    // when sort is called - returns a std::vector sorted according to the DAG
+    //
+    //
+
+    template<
+        class Key,
+        class T,
+        class Compare = std::less<Key>,
+        class Allocator = std::allocator<std::pair<const Key, T>>,
+        class Traits = default_sorter_traits< Key, Compare > >
+    struct topological_sort_map : 
+        std::map< Key, T, Compare, Allocator>,
+        topological_sorter< Key, Traits >
+    {
+        // Adapter types
+        using container = std::map< Key, T, Compare, Allocator>;
+        using sorter    = topological_sorter< Key, Traits >;
+        using sort_type = typename sorter::template associative_sort_type<T>;
+        using visited_type = typename sorter::visited_type;
+        
+        // STL types
+        using key_type          = typename container::key_type;
+        using mapped_type       = typename container::mapped_type;
+        using value_type        = typename container::value_type;
+        using size_type         = typename container::size_type;
+        using difference_type   = typename container::difference_type;
+        using key_compare       = typename container::key_compare;
+        using allocator_type    = typename container::allocator_type;
+        using reference         = typename container::reference;
+        using const_reference   = typename container::const_reference;
+        using pointer           = typename container::pointer;
+        using const_pointer     = typename container::const_pointer;
+        using iterator          = typename container::iterator;
+        using const_iterator    = typename container::const_iterator;
+        using reverse_iterator  = typename container::reverse_iterator;
+        using const_reverse_iterator    = typename container::const_reverse_iterator;
+        using node_type         = typename container::node_type;
+        
+        // Forwarding constructor
+        template <typename...Xs>
+        topological_sort_map( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
+        
+        // Destructor
+        ~topological_sort_map() {};
+        
+        sort_type sort() &
+        {
+            // Topological order - cached until the next precede
+            const auto& dag = this->sorter::ordered();
+            
+            // Now return our ordered vector
+            sort_type result;
+            
+            // First copy in the elements in topological order - keys in the DAG but not in the container are ignored
+            std::ranges::for_each( dag.order(),
+                         [&](const auto& key) {
+                if ( auto it = this->container::find( key ); it != this->container::end() )
+                    result.emplace_back( *it );
+                        } );
+            
+            // Now copy the rest make sure that we haven't missed anything - the keys that are not in the DAG
+            // By defintion - we put these last since putting them first may violate other topological constraints - eg sort is called before precede...
+            for (const auto& [key,value] : *this )
+            {
+                if ( !dag.contains( key ) )
+                    result.emplace_back( std::make_pair(key, value) );
+            }
+            return result;
+        }
+        
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+        // eg g.sort( std::execution::par_unseq ) - the lookups and the checks against the DAG run under the policy
+        // The depth first search itself is inherently serial and is unchanged
+        template <typename ExecutionPolicy>
+            requires std::is_execution_policy_v< std::remove_cvref_t<ExecutionPolicy> >
+        sort_type sort( ExecutionPolicy&& policy ) &
+        {
+            return this->sorter::template associative_sort<T>( policy, static_cast< const container& >( *this ) );
+        }
+#endif
+        
+        // Consuming sort - eg auto v = std::move(g).sort();
+        // Each element is extract()ed from the container and its key and value moved into the result - nothing is copied
+        // Nodes are released one at a time as we go, so the container and the result are never both fully populated
+        // Lookups are O(log N) as for sort() &
+        // The container is left empty, the DAG is untouched
+        sort_type sort() &&
+        {
+            // Topological order - cached until the next precede
+            const auto& dag = this->sorter::ordered();
+            
+            sort_type result;
+            result.reserve( this->container::size() );
+            
+            // Keys in the DAG but not in the container give an empty node - ignore them
+            std::ranges::for_each( dag.order(),
+                         [&](const auto& key) {
+                auto node = this->container::extract( key );
+                if ( !node.empty() )
+                    result.emplace_back( std::move( node.key() ), std::move( node.mapped() ) );
+                        } );
+            
+            // Whatever is left was not in the DAG - it goes last, as above
+            while ( !this->container::empty() )
+            {
+                auto node = this->container::extract( this->container::begin() );
+                result.emplace_back( std::move( node.key() ), std::move( node.mapped() ) );
+            }
+            return result;
+        }
+    };  // struct topological_sort_map
+
+    //
+    // std::unordered map drop in replacement
+    // when sort is called - returns a std::vector sorted according to the DAG
+    // The DAG is kept in flat hash maps built from Hash, KeyEqual and Allocator - keys need no operator<
+    // The maps are built from the container's own hash_function(), key_eq() and get_allocator() as constructed - a seeded hasher hashes the same in both
+    //
+
+    template<
+        class Key,
+        class T,
+        class Hash = std::hash<Key>,
+        class KeyEqual = std::equal_to<Key>,
+        class Allocator = std::allocator<std::pair<const Key, T>>,
+        class Traits = hashed_sorter_traits< Key, Hash, KeyEqual, Allocator > >
+    struct topological_sort_unordered_map :
+        std::unordered_map< Key, T, Hash, KeyEqual, Allocator >,
+        topological_sorter< Key, Traits >
+    {
+        // Adapter types
+        using container = std::unordered_map< Key, T, Hash, KeyEqual, Allocator >;
+        using sorter    = topological_sorter< Key, Traits >;
+        using sort_type = typename sorter::template associative_sort_type<T>;
+        using visited_type = typename sorter::visited_type;
+        
+        // STL types
+        using key_type          = typename container::key_type;
+        using mapped_type       = typename container::mapped_type;
+        using value_type        = typename container::value_type;
+        using size_type         = typename container::size_type;
+        using difference_type   = typename container::difference_type;
+        using hasher            = typename container::hasher;
+        using key_equal         = typename container::key_equal;
+        using allocator_type    = typename container::allocator_type;
+        using reference         = typename container::reference;
+        using const_reference   = typename container::const_reference;
+        using pointer           = typename container::pointer;
+        using const_pointer     = typename container::const_pointer;
+        using iterator          = typename container::iterator;
+        using const_iterator    = typename container::const_iterator;
+        using local_iterator    = typename container::local_iterator;
+        using const_local_iterator    = typename container::const_local_iterator;
+        using node_type         = typename container::node_type;
+        using insert_return_type= typename container::insert_return_type;
+        
+        // Forwarding constructor - the container is built first, so hashed traits can take its hasher, key equality and allocator
+        template <typename...Xs>
+        topological_sort_unordered_map( Xs&&...xs ) :
+            container{ std::forward<Xs>(xs)... },
+            sorter( map_state_of( *this ) ) {};
+        
+        // Destructor
+        ~topological_sort_unordered_map() {};
+        
+        sort_type sort() &
+        {
+            // Topological order - cached until the next precede
+            const auto& dag = this->sorter::ordered();
+            
+            // Now return our ordered vector
+            sort_type result;
+            
+            // First copy in the elements in topological order - keys in the DAG but not in the container are ignored
+            std::ranges::for_each( dag.order(),
+                         [&](const auto& key) {
+                if ( auto it = this->container::find( key ); it != this->container::end() )
+                    result.emplace_back( *it );
+                        } );
+            
+            // Now copy the rest make sure that we haven't missed anything - the keys that are not in the DAG
+            // By defintion - we put these last since putting them first may violate other topological constraints - eg sort is called before precede...
+            for (const auto& [key,value] : *this )
+            {
+                if ( !dag.contains( key ) )
+                    result.emplace_back( std::make_pair(key, value) );
+            }
+            return result;
+        }
+        
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+        // eg g.sort( std::execution::par_unseq ) - the lookups and the checks against the DAG run under the policy
+        // The depth first search itself is inherently serial and is unchanged
+        template <typename ExecutionPolicy>
+            requires std::is_execution_policy_v< std::remove_cvref_t<ExecutionPolicy> >
+        sort_type sort( ExecutionPolicy&& policy ) &
+        {
+            return this->sorter::template associative_sort<T>( policy, static_cast< const container& >( *this ) );
+        }
+#endif
+        
+        // Consuming sort - eg auto v = std::move(g).sort();
+        // Each element is extract()ed from the container and its key and value moved into the result - nothing is copied
+        // Nodes are released one at a time as we go, so the container and the result are never both fully populated
+        // extract() never rehashes, so the bucket array is kept and reused if the container is filled again
+        // The container is left empty, the DAG is untouched
+        sort_type sort() &&
+        {
+            // Topological order - cached until the next precede
+            const auto& dag = this->sorter::ordered();
+            
+            sort_type result;
+            result.reserve( this->container::size() );
+            
+            // Keys in the DAG but not in the container give an empty node - ignore them
+            std::ranges::for_each( dag.order(),
+                         [&](const auto& key) {
+                auto node = this->container::extract( key );
+                if ( !node.empty() )
+                    result.emplace_back( std::move( node.key() ), std::move( node.mapped() ) );
+                        } );
+            
+            // Whatever is left was not in the DAG - it goes last, as above
+            while ( !this->container::empty() )
+            {
+                auto node = this->container::extract( this->container::begin() );
+                result.emplace_back( std::move( node.key() ), std::move( node.mapped() ) );
+            }
+            return result;
+        }
+        
+    private:
+        // Other traits (eg interned) keep no container state
+        static typename sorter::map_state_type map_state_of( const container& c )
+        {
+            if constexpr ( std::is_same_v< Traits, hashed_sorter_traits< Key, Hash, KeyEqual, Allocator > > )
+                return { c.hash_function(), c.key_eq(), c.get_allocator() };
+            else
+                return {};
+        }
+    };  // struct topological_sort_unordered_map
+
+    //
+    // std::multimap drop in replacement
+    // when sort is called - returns a std::vector sorted according to the DAG
+    // All the elements of a key are one run in the container - equal_range finds it and it is emitted with a single bulk insert
+    // Complexity O(N + V + E) element copies plus O(V log N) to find the runs - no counting
+    //
+
+    template<
+        class Key,
+        class T,
+        class Compare = std::less<Key>,
+        class Allocator = std::allocator<std::pair<const Key, T>>,
+        class Traits = default_sorter_traits< Key, Compare > >
+    struct topological_sort_multimap :
+        std::multimap< Key, T, Compare, Allocator>,
+        topological_sorter< Key, Traits >
+    {
+        // Adapter types
+        using container = std::multimap< Key, T, Compare, Allocator>;
+        using sorter    = topological_sorter< Key, Traits >;
+        using sort_type = typename sorter::template associative_sort_type<T>;
+        using visited_type = typename sorter::visited_type;
+        
+        // STL types
+        using key_type          = typename container::key_type;
+        using mapped_type       = typename container::mapped_type;
+        using value_type        = typename container::value_type;
+        using size_type         = typename container::size_type;
+        using difference_type   = typename container::difference_type;
+        using key_compare       = typename container::key_compare;
+        using allocator_type    = typename container::allocator_type;
+        using reference         = typename container::reference;
+        using const_reference   = typename container::const_reference;
+        using pointer           = typename container::pointer;
+        using const_pointer     = typename container::const_pointer;
+        using iterator          = typename container::iterator;
+        using const_iterator    = typename container::const_iterator;
+        using reverse_iterator  = typename container::reverse_iterator;
+        using const_reverse_iterator    = typename container::const_reverse_iterator;
+        using node_type         = typename container::node_type;
+        
+        // Forwarding constructor
+        template <typename...Xs>
+        topological_sort_multimap( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
+        
+        // Destructor
+        ~topological_sort_multimap() {};
+        
+        // Elements of the same key keep their insertion order
+        sort_type sort() &
+        {
+            // Topological order - cached until the next precede
+            const auto& dag = this->sorter::ordered();
+            
+            sort_type result;
+            result.reserve( this->container::size() );
+            
+            // First copy in the runs from the topological sort - a key in the DAG but not in the container is an empty run
+            std::ranges::for_each( dag.order(),
+                         [&](const auto& key) {
+                auto [lo, hi] = this->container::equal_range( key );
+                std::copy( lo, hi, std::back_inserter( result ) );
+                        } );
+            
+            // Now copy the rest a run at a time - they go last as for the other adapters
+            for ( auto it = this->container::begin(); it != this->container::end(); )
+            {
+                auto hi = this->container::upper_bound( it->first );
+                if ( !dag.contains( it->first ) )
+                    std::copy( it, hi, std::back_inserter( result ) );
+                it = hi;
+            }
+            return result;
+        }
+        
+        // Consuming sort - eg auto v = std::move(g).sort();
+        // Each run is moved into the result and erased in one go - the mapped values are moved, not copied
+        // The container is left empty, the DAG is untouched
+        sort_type sort() &&
+        {
+            // Topological order - cached until the next precede
+            const auto& dag = this->sorter::ordered();
+            
+            sort_type result;
+            result.reserve( this->container::size() );
+            
+            std::ranges::for_each( dag.order(),
+                         [&](const auto& key) {
+                auto [lo, hi] = this->container::equal_range( key );
+                std::move( lo, hi, std::back_inserter( result ) );
+                this->container::erase( lo, hi );
+                        } );
+            
+            // Whatever is left was not in the DAG - it goes last, as above
+            std::move( this->container::begin(), this->container::end(), std::back_inserter( result ) );
+            this->container::clear();
+            return result;
+        }
+    };  // struct topological_sort_multimap
+
+    //
+    // std::multiset drop in replacement
+    // when sort is called - returns a std::vector sorted according to the DAG
+    // Each key's run is found with equal_range and emitted with a single bulk insert
+    //
+
+    template<
+        class Key,
+        class Compare = std::less<Key>,
+        class Allocator = std::allocator<Key>,
+        class Traits = default_sorter_traits< Key, Compare > >
+    struct topological_sort_multiset :
+        std::multiset< Key, Compare, Allocator>,
+        topological_sorter< Key, Traits >
+    {
+        // Adapter types
+        using container = std::multiset< Key, Compare, Allocator>;
+        using sorter    = topological_sorter< Key, Traits >;
+        using sort_type = typename sorter::template vector_sort_type<Key>;
+        using visited_type = typename sorter::visited_type;
+        
+        // STL types
+        using key_type          = typename container::key_type;
+        using value_type        = typename container::value_type;
+        using size_type         = typename container::size_type;
+        using difference_type   = typename container::difference_type;
+        using key_compare       = typename container::key_compare;
+        using value_compare     = typename container::value_compare;
+        using allocator_type    = typename container::allocator_type;
+        using reference         = typename container::reference;
+        using const_reference   = typename container::const_reference;
+        using pointer           = typename container::pointer;
+        using const_pointer     = typename container::const_pointer;
+        using iterator          = typename container::iterator;
+        using const_iterator    = typename container::const_iterator;
+        using reverse_iterator  = typename container::reverse_iterator;
+        using const_reverse_iterator    = typename container::const_reverse_iterator;
+        using node_type         = typename container::node_type;
+        
+        // Forwarding constructor
+        template <typename...Xs>
+        topological_sort_multiset( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
+        
+        // Destructor
+        ~topological_sort_multiset() {};
+        
+        sort_type sort()
+        {
+            // Topological order - cached until the next precede
+            const auto& dag = this->sorter::ordered();
+            
+            sort_type result;
+            result.reserve( this->container::size() );
+            
+            // First copy in the runs from the topological sort - a key in the DAG but not in the container is an empty run
+            std::ranges::for_each( dag.order(),
+                         [&](const auto& key) {
+                auto [lo, hi] = this->container::equal_range( key );
+                result.insert( result.end(), lo, hi );
+                        } );
+            
+            // Now copy the rest a run at a time - they go last as for the other adapters
+            for ( auto it = this->container::begin(); it != this->container::end(); )
+            {
+                auto hi = this->container::upper_bound( *it );
+                if ( !dag.contains( *it ) )
+                    result.insert( result.end(), it, hi );
+                it = hi;
+            }
+            return result;
+        }
+    };  // struct topological_sort_multiset
+
+    //
+    // Flat associative container - modelled on C++23 std::flat_map
+    // Keys and values live in two parallel contiguous containers with the keys kept sorted by Compare - lookups are a binary search
+    // when sort is called - returns the key and value containers reordered according to the DAG
+    // The sort finds the slot of each DAG key, then gathers the keys and the values by slot - linear passes over contiguous memory
+    //
+
+    template<
+        class Key,
+        class T,
+        class Compare = std::less<Key>,
+        class KeyContainer = std::vector<Key>,
+        class MappedContainer = std::vector<T>,
+        class Traits = default_sorter_traits< Key, Compare > >
+    struct topological_sort_flat_map :
+        topological_sorter< Key, Traits >
+    {
+        // Adapter types
+        using sorter    = topological_sorter< Key, Traits >;
+        
+        // As std::flat_map::containers
+        struct containers
+        {
+            KeyContainer    keys;
+            MappedContainer values;
+        };
+        using sort_type = containers;
+        
+        // STL types
+        using key_type              = Key;
+        using mapped_type           = T;
+        using value_type            = std::pair<Key, T>;
+        using key_compare           = Compare;
+        using reference             = std::pair<const Key&, T&>;
+        using const_reference       = std::pair<const Key&, const T&>;
+        using size_type             = std::size_t;
+        using difference_type       = std::ptrdiff_t;
+        using key_container_type    = KeyContainer;
+        using mapped_container_type = MappedContainer;
+        
+        // Iterates the slots in key order - dereferences to a pair of references into the two containers
+        template <bool Const>
+        class basic_iterator
+        {
+        public:
+            using owner_type        = std::conditional_t< Const, const topological_sort_flat_map, topological_sort_flat_map >;
+            using value_type        = topological_sort_flat_map::value_type;
+            using reference         = std::conditional_t< Const, const_reference, topological_sort_flat_map::reference >;
+            using difference_type   = std::ptrdiff_t;
+            using iterator_category = std::bidirectional_iterator_tag;
+            
+            struct pointer
+            {
+                reference ref;
+                const reference* operator->() const { return &ref; }
+            };
+            
+            basic_iterator() = default;
+            basic_iterator( owner_type* owner, size_type slot ) : owner( owner ), slot( slot ) {};
+            
+            // iterator converts to const_iterator
+            operator basic_iterator<true>() const requires ( !Const ) { return { owner, slot }; }
+            
+            reference operator*() const { return { owner->c.keys[slot], owner->c.values[slot] }; }
+            pointer operator->() const  { return { **this }; }
+            
+            basic_iterator& operator++()    { ++slot; return *this; }
+            basic_iterator operator++(int)  { auto it = *this; ++slot; return it; }
+            basic_iterator& operator--()    { --slot; return *this; }
+            basic_iterator operator--(int)  { auto it = *this; --slot; return it; }
+            
+            bool operator==( const basic_iterator& other ) const { return slot == other.slot; }
+            
+            size_type index() const { return slot; }
+            
+        private:
+            owner_type* owner{ nullptr };
+            size_type   slot{ 0 };
+        };
+        
+        using iterator          = basic_iterator<false>;
+        using const_iterator    = basic_iterator<true>;
+        
+        topological_sort_flat_map() = default;
+        
+        topological_sort_flat_map( std::initializer_list<value_type> il )
+        {
+            for ( const auto& [key, value] : il )
+                insert_or_assign( key, value );
+        }
+        
+        // Destructor
+        ~topological_sort_flat_map() {};
+        
+        iterator begin()                { return { this, 0 }; }
+        iterator end()                  { return { this, size() }; }
+        const_iterator begin() const    { return { this, 0 }; }
+        const_iterator end() const      { return { this, size() }; }
+        
+        size_type size() const          { return c.keys.size(); }
+        bool empty() const              { return c.keys.empty(); }
+        
+        void clear()
+        {
+            c.keys.clear();
+            c.values.clear();
+        }
+        
+        const KeyContainer& keys() const        { return c.keys; }
+        const MappedContainer& values() const   { return c.values; }
+        
+        iterator find( const Key& key )
+        {
+            auto slot = lower_bound_slot( key );
+            return slot < size() && !compare( key, c.keys[slot] ) ? iterator{ this, slot } : end();
+        }
+        
+        const_iterator find( const Key& key ) const
+        {
+            auto slot = lower_bound_slot( key );
+            return slot < size() && !compare( key, c.keys[slot] ) ? const_iterator{ this, slot } : end();
+        }
+        
+        bool contains( const Key& key ) const   { return find( key ) != end(); }
+        size_type count( const Key& key ) const { return contains( key ) ? 1 : 0; }
+        
+        T& at( const Key& key )
+        {
+            auto it = find( key );
+            if ( it == end() ) throw std::out_of_range( "snicholls::topological_sort_flat_map::at" );
+            return c.values[ it.index() ];
+        }
+        
+        const T& at( const Key& key ) const
+        {
+            auto it = find( key );
+            if ( it == end() ) throw std::out_of_range( "snicholls::topological_sort_flat_map::at" );
+            return c.values[ it.index() ];
+        }
+        
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace( const Key& key, Args&&... args )
+        {
+            auto slot = lower_bound_slot( key );
+            if ( slot < size() && !compare( key, c.keys[slot] ) )
+                return { iterator{ this, slot }, false };
+            
+            c.keys.insert( c.keys.begin() + slot, key );
+            c.values.emplace( c.values.begin() + slot, std::forward<Args>(args)... );
+            return { iterator{ this, slot }, true };
+        }
         
-        adjacency_type adj;
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign( const Key& key, M&& value )
+        {
+            auto result = try_emplace( key, std::forward<M>(value) );
+            if ( !result.second )
+                c.values[ result.first.index() ] = std::forward<M>(value);
+            return result;
+        }
         
-        ~topological_sorter() {};
+        T& operator[]( const Key& key ) { return c.values[ try_emplace( key ).first.index() ]; }
         
-        // Means v must occur before w
-        // Use this method to form the Directed Acyclic Graph ("DAG")
-        // Note that these elements are not automatically inserted into the container - this is by design
-        // The DAG represents a constraint
-        // We cleanly seperate the contents of the container from the constraints that we impose on the container
-        constexpr
-        void precede( Key v, Key w )
+        size_type erase( const Key& key )
         {
-            adj[v].push_back(w); // All w's must come after v
+            auto it = find( key );
+            if ( it == end() ) return 0;
+            c.keys.erase( c.keys.begin() + it.index() );
+            c.values.erase( c.values.begin() + it.index() );
+            return 1;
         }
-       
-        // Note may be stack heavy for very large DAGs ... in practice not found this to be an issue...
-        void sort_util( Key v, visited_type& visited, stack_type& s )
+        
+        // As std::flat_map::extract - the container is left empty
+        containers extract() &&
         {
-            visited[v] = true;
-
-            // Note that if a key does not exist in the adjacency map - we create it - function is deliberately non-const
-            for ( const auto& i : adj[v] )
-                if (!visited[i])
-                    sort_util( i, visited, s );
+            containers result{ std::move( c.keys ), std::move( c.values ) };
+            clear();
+            return result;
+        }
+        
+        // Keys that are not in the DAG go last, in key order - as for topological_sort_map
+        sort_type sort() &
+        {
+            auto order = slot_order();
             
-            s.push(v);
+            sort_type result;
+            result.keys.reserve( order.size() );
+            result.values.reserve( order.size() );
+            for ( auto slot : order ) result.keys.push_back( c.keys[slot] );
+            for ( auto slot : order ) result.values.push_back( c.values[slot] );
+            return result;
         }
-
-        // Note that this is non-const - it is by design for use cases where we repeatedly call topological_sort - marginal increase in performance for sort_util above
-        stack_type topological_sort()
+        
+        // Consuming sort - eg auto v = std::move(g).sort();
+        // The key and value containers are permuted where they are and handed over - nothing is copied
+        // The container is left empty, the DAG is untouched
+        sort_type sort() &&
         {
-            // Mark all the vertices as not visited - std::map<Key,bool> defaults to false
-            visited_type visited;
-            stack_type s;
+            auto order = slot_order();
+            permute_in_place( c.keys.begin(), order );
+            permute_in_place( c.values.begin(), std::move( order ) );
+            return std::move( *this ).extract();
+        }
+        
+    private:
+        size_type lower_bound_slot( const Key& key ) const
+        {
+            return static_cast< size_type >( std::lower_bound( c.keys.begin(), c.keys.end(), key, compare ) - c.keys.begin() );
+        }
+        
+        // Slots in topological order - a binary search per DAG key, then a linear pass for the slots that were not reached
+        std::vector< std::size_t > slot_order()
+        {
+            const auto& dag = this->sorter::ordered();
             
-            for ( const auto& [key, value] : adj )
-                if (visited[key] == false)
-                   sort_util( key, visited, s );
+            std::vector< std::size_t > order;
+            order.reserve( size() );
+            std::vector< bool > placed( size(), false );
             
-            return s;
+            // Keys in the DAG but not in the container are skipped
+            std::ranges::for_each( dag.order(),
+                         [&](const auto& key) {
+                auto slot = lower_bound_slot( key );
+                if ( slot < size() && !compare( key, c.keys[slot] ) )
+                {
+                    order.push_back( slot );
+                    placed[slot] = true;
+                }
+                        } );
+            
+            for ( std::size_t slot{0}; slot < size(); ++slot )
+                if ( !placed[slot] )
+                    order.push_back( slot );
+            return order;
         }
-    };
+        
+        containers c;
+        [[no_unique_address]] Compare compare;
+    };  // struct topological_sort_flat_map
 
     //
-    // Associative containers
-    //
-    // std::map - drop in replacement
-    // when sort is called - returns a std::vector sorted according to the DAG
-    //
+    // Sequence containers
+    // std::vector
     //
 
     template<
-        class Key,
         class T,
-        class Compare = std::less<Key>,
-        class Allocator = std::allocator<std::pair<const Key, T>> >
-    struct topological_sort_map : 
-        std::map< Key, T, Compare, Allocator>,
-        topological_sorter< Key >
+        class Allocator = std::allocator<T>,
+        class Traits = default_sorter_traits<T>
+    > struct topological_sort_vector : 
+        std::vector<T, Allocator>,
+        topological_sorter< T, Traits >
     {
         // Adapter types
-        using container = std::map< Key, T, Compare, Allocator>;
-        using sorter    = topological_sorter< Key >;
-        using sort_type = typename sorter::template associative_sort_type<T>;
+        using container = std::vector< T, Allocator>;
+        using sorter    = topological_sorter< T, Traits >;
+        using sort_type = typename sorter::template vector_sort_type<T>;
         using visited_type = typename sorter::visited_type;
         
         // STL types
-        using key_type          = typename container::key_type;
-        using mapped_type       = typename container::mapped_type;
         using value_type        = typename container::value_type;
         using size_type         = typename container::size_type;
         using difference_type   = typename container::difference_type;
-        using key_compare       = typename container::key_compare;
         using allocator_type    = typename container::allocator_type;
         using reference         = typename container::reference;
         using const_reference   = typename container::const_reference;
@@ -141,76 +3604,75 @@ namespace snicholls {
         using const_iterator    = typename container::const_iterator;
         using reverse_iterator  = typename container::reverse_iterator;
         using const_reverse_iterator    = typename container::const_reverse_iterator;
-        using node_type         = typename container::node_type;
-        
+      
         // Forwarding constructor
         template <typename...Xs>
-        topological_sort_map( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
+        topological_sort_vector( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
         
         // Destructor
-        ~topological_sort_map() {};
+        ~topological_sort_vector() {};
         
+        // Elements whose keys are in the DAG first, in topological order, then the rest in order of first appearance - equal elements stay together
+        // Only the counting sort and the copy are redone on each call - the topological order is cached until the next precede
         sort_type sort()
         {
-            // Do the topological sort
-            auto s = this->sorter::topological_sort();
+            auto order = this->sorter::rank_order( this->begin(), this->end(), std::identity{} );
             
-            // Now return our ordered vector
             sort_type result;
-            // Has this particular key been copied to the result ?
-            visited_type copied;
-            
-            // First copy in the elements from the topological sort using stack helper
-            stack_helper( s,
-                         [&](const auto key) {
-                auto value = this->container::at( key );
-                result.emplace_back( std::make_pair( key, value ) );
-                copied[key] = true;
-                        } );
+            result.reserve( order.size() );
+            for ( auto i : order ) result.push_back( (*this)[i] );
+            return result;
+        }
+        
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+        // eg g.sort( std::execution::par_unseq ) - the rank lookups and the copy into the result run under the policy
+        // Same result as sort() - duplicates are placed by a counting sort rather than by counting each key
+        template <typename ExecutionPolicy>
+            requires std::is_execution_policy_v< std::remove_cvref_t<ExecutionPolicy> >
+        sort_type sort( ExecutionPolicy&& policy )
+        {
+            auto order = this->sorter::rank_order( policy, this->begin(), this->end(), std::identity{} );
             
-            // Now copy the rest make sure that we haven't missed anything
-            // By defintion - we put these last since putting them first may violate other topological constraints - eg sort is called before precede...
-            for (const auto& [key,value] : *this )
+            sort_type result;
+            if constexpr ( std::is_default_constructible_v<T> && std::is_copy_assignable_v<T> )
             {
-                if ( copied[key] == false )
-                {
-                    copied[key] = true;
-                    result.emplace_back( std::make_pair(key, value) );
-                }
+                result.resize( order.size() );
+                std::transform( policy, order.begin(), order.end(), result.begin(), [&](auto i) { return (*this)[i]; } );
+            }
+            else
+            {
+                result.reserve( order.size() );
+                for ( auto i : order ) result.push_back( (*this)[i] );
             }
             return result;
         }
-    };  // struct topological_sort_map
+#endif
+    }; // struct topological_sort_vector
 
     //
-    // std::unordered map drop in replacement
-    // when sort is called - returns a std::vector sorted according to the DAG
+    // std::vector of records ordered by a key derived from each element
+    // eg topological_sort_keyed_vector<std::string, Task> ordered by Task::name - the DAG is over the keys, not the elements
+    // when sort is called - returns a std::vector sorted according to the DAG, elements with equal keys keep their relative order
     //
 
     template<
         class Key,
         class T,
-        class Hash = std::hash<Key>,
-        class KeyEqual = std::equal_to<Key>,
-        class Allocator = std::allocator<std::pair<const Key, T>> >
-    struct topological_sort_unordered_map :
-        std::unordered_map< Key, T, Hash, KeyEqual, Allocator >,
-        topological_sorter< Key >
+        class Allocator = std::allocator<T>,
+        class Traits = default_sorter_traits<Key>
+    > struct topological_sort_keyed_vector :
+        std::vector<T, Allocator>,
+        topological_sorter< Key, Traits >
     {
         // Adapter types
-        using container = std::unordered_map< Key, T, Hash, KeyEqual, Allocator >;
-        using sorter    = topological_sorter< Key >;
-        using sort_type = typename sorter::template associative_sort_type<T>;
-        using visited_type = typename sorter::visited_type;
+        using container = std::vector< T, Allocator>;
+        using sorter    = topological_sorter< Key, Traits >;
+        using sort_type = typename sorter::template vector_sort_type<T>;
         
         // STL types
-        using key_type          = typename container::key_type;
-        using mapped_type       = typename container::mapped_type;
         using value_type        = typename container::value_type;
         using size_type         = typename container::size_type;
         using difference_type   = typename container::difference_type;
-        using hasher            = typename container::hasher;
-        using key_equal         = typename container::key_equal;
         using allocator_type    = typename container::allocator_type;
         using reference         = typename container::reference;
         using const_reference   = typename container::const_reference;
@@ -218,67 +3680,49 @@ namespace snicholls {
         using const_pointer     = typename container::const_pointer;
         using iterator          = typename container::iterator;
         using const_iterator    = typename container::const_iterator;
-        using local_iterator    = typename container::local_iterator;
-        using const_local_iterator    = typename container::const_local_iterator;
-        using node_type         = typename container::node_type;
-        using insert_return_type= typename container::insert_return_type;
+        using reverse_iterator  = typename container::reverse_iterator;
+        using const_reverse_iterator    = typename container::const_reverse_iterator;
         
         // Forwarding constructor
         template <typename...Xs>
-        topological_sort_unordered_map( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
+        topological_sort_keyed_vector( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
         
         // Destructor
-        ~topological_sort_unordered_map() {};
+        ~topological_sort_keyed_vector() {};
         
-        sort_type sort()
+        // proj is anything std::invoke can call with an element to give its Key - a lambda or a pointer to member such as &Task::name
+        // Each element is copied exactly once - straight into the result
+        template <typename Proj>
+        sort_type sort( Proj&& proj )
         {
-            // Do the topological sort
-            auto s = this->sorter::topological_sort();
+            auto order = this->sorter::rank_order( this->begin(), this->end(), std::forward<Proj>(proj) );
             
-            // Now return our ordered vector
             sort_type result;
-            // Has this particular key been copied to the result ?
-            visited_type copied;
-            
-            // First copy in the elements from the topological sort using stack helper
-            stack_helper( s,
-                         [&](const auto key) {
-                auto value = this->container::at( key );
-                result.emplace_back( std::make_pair( key, value ) );
-                copied[key] = true;
-                        } );
-            
-            // Now copy the rest make sure that we haven't missed anything
-            // By defintion - we put these last since putting them first may violate other topological constraints - eg sort is called before precede...
-            for (const auto& [key,value] : *this )
-            {
-                if ( copied[key] == false )
-                {
-                    copied[key] = true;
-                    result.emplace_back( std::make_pair(key, value) );
-                }
-            }
+            result.reserve( order.size() );
+            for ( auto i : order )
+                result.push_back( (*this)[i] );
             return result;
         }
-    };  // struct topological_sort_unordered_map
-
+    }; // struct topological_sort_keyed_vector
+ 
     //
     // Sequence containers
-    // std::vector
+    // std::list - sorted in place
+    // sort() relinks the nodes into topological order with splice - no element is copied or moved and every iterator stays valid
+    // Comparison sorts are still available as sort( comp )
     //
 
     template<
         class T,
-        class Allocator = std::allocator<T>
-    > struct topological_sort_vector : 
-        std::vector<T, Allocator>,
-        topological_sorter< T >
+        class Allocator = std::allocator<T>,
+        class Traits = default_sorter_traits<T>
+    > struct topological_sort_list :
+        std::list<T, Allocator>,
+        topological_sorter< T, Traits >
     {
         // Adapter types
-        using container = std::vector< T, Allocator>;
-        using sorter    = topological_sorter< T >;
-        using sort_type = typename sorter::template vector_sort_type<T>;
-        using visited_type = typename sorter::visited_type;
+        using container = std::list< T, Allocator>;
+        using sorter    = topological_sorter< T, Traits >;
         
         // STL types
         using value_type        = typename container::value_type;
@@ -293,48 +3737,120 @@ namespace snicholls {
         using const_iterator    = typename container::const_iterator;
         using reverse_iterator  = typename container::reverse_iterator;
         using const_reverse_iterator    = typename container::const_reverse_iterator;
-      
+        
         // Forwarding constructor
         template <typename...Xs>
-        topological_sort_vector( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
+        topological_sort_list( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
         
         // Destructor
-        ~topological_sort_vector() {};
+        ~topological_sort_list() {};
         
-        sort_type sort()
+        using container::sort;
+        
+        // The order is a counting sort of the cached ranks, then each node in turn is spliced onto the end - O(N) relinks, never a node allocated, copied or moved
+        // Allocates O(N) extra - an iterator per node, the order and the ranks of the elements - and the ranks of keys not in the DAG
+        // Keys that are not in the DAG go last, in order of first appearance, equal keys keep their relative order
+        void sort()
         {
-            // Do the topological sort
-            auto s = this->sorter::topological_sort();
+            std::vector< iterator > nodes;
+            nodes.reserve( this->container::size() );
+            for ( auto it = this->container::begin(); it != this->container::end(); ++it )
+                nodes.push_back( it );
             
-            // Now return our ordered vector
-            sort_type result;
-            // Has this particular key been copied to the result ?
-            visited_type copied;
-            
-            // First copy in the elements from the topological sort using stack helper
-            stack_helper( s,
-                         [&](const auto key) {
-                        // Make sure that our result is the same length - if key occurs n times, insert it n times - if a key does not occur at all - ignore it
-                        auto n = std::count( this->begin(), this->end(), key );
-                        for (auto i{0};i<n;++i) result.emplace_back( key );
-                        copied[key] = true;
-                        } );
-            
-            // Now copy the rest make sure that we haven't missed anything
-            // By defintion - we put these last since putting them first may violate other topological constraints - eg sort is called before precede...
-            for (const auto& key : *this )
-            {
-                if ( copied[key] == false )
-                {
-                    copied[key] = true;
-                    auto n = std::count( this->begin(), this->end(), key );
-                    for (auto i{0};i<n;++i) result.emplace_back( key );
-                }
-            }
-            return result;
+            for ( auto i : this->sorter::template rank_order< std::uint32_t >( this->container::begin(), this->container::end(), std::identity{} ) )
+                this->container::splice( this->container::end(), *this, nodes[i] );
         }
-    }; // struct topological_sort_vector
- 
+    }; // struct topological_sort_list
+
+    //
+    // Sequence containers
+    // std::deque - sorted in place
+    // sort() permutes the elements where they are - no vector is built and each element is moved once
+    //
+
+    template<
+        class T,
+        class Allocator = std::allocator<T>,
+        class Traits = default_sorter_traits<T>
+    > struct topological_sort_deque :
+        std::deque<T, Allocator>,
+        topological_sorter< T, Traits >
+    {
+        // Adapter types
+        using container = std::deque< T, Allocator>;
+        using sorter    = topological_sorter< T, Traits >;
+        
+        // STL types
+        using value_type        = typename container::value_type;
+        using size_type         = typename container::size_type;
+        using difference_type   = typename container::difference_type;
+        using allocator_type    = typename container::allocator_type;
+        using reference         = typename container::reference;
+        using const_reference   = typename container::const_reference;
+        using pointer           = typename container::pointer;
+        using const_pointer     = typename container::const_pointer;
+        using iterator          = typename container::iterator;
+        using const_iterator    = typename container::const_iterator;
+        using reverse_iterator  = typename container::reverse_iterator;
+        using const_reverse_iterator    = typename container::const_reverse_iterator;
+        
+        // Forwarding constructor
+        template <typename...Xs>
+        topological_sort_deque( Xs&&...xs ) : container{ std::forward<Xs>(xs)... } {};
+        
+        // Destructor
+        ~topological_sort_deque() {};
+        
+        // Keys that are not in the DAG go last, in order of first appearance, equal keys keep their relative order
+        void sort()
+        {
+            permute_in_place( this->begin(), this->sorter::rank_order( this->begin(), this->end(), std::identity{} ) );
+        }
+    }; // struct topological_sort_deque
+
+    //
+    // std::span - memory we do not own, eg a shared memory segment or another library's buffer
+    // sort() permutes the viewed elements in place - there is no intermediate copy at all
+    //
+
+    template<
+        class T,
+        std::size_t Extent = std::dynamic_extent,
+        class Traits = default_sorter_traits< std::remove_cv_t<T> >
+    > struct topological_sort_span :
+        std::span<T, Extent>,
+        topological_sorter< std::remove_cv_t<T>, Traits >
+    {
+        // Adapter types
+        using container = std::span< T, Extent>;
+        using sorter    = topological_sorter< std::remove_cv_t<T>, Traits >;
+        
+        // STL types
+        using element_type      = typename container::element_type;
+        using value_type        = typename container::value_type;
+        using size_type         = typename container::size_type;
+        using difference_type   = typename container::difference_type;
+        using reference         = typename container::reference;
+        using const_reference   = typename container::const_reference;
+        using pointer           = typename container::pointer;
+        using const_pointer     = typename container::const_pointer;
+        using iterator          = typename container::iterator;
+        using reverse_iterator  = typename container::reverse_iterator;
+        
+        // Forwarding constructor
+        template <typename...Xs>
+        topological_sort_span( Xs&&...xs ) : container( std::forward<Xs>(xs)... ) {};
+        
+        // Destructor
+        ~topological_sort_span() {};
+        
+        // Keys that are not in the DAG go last, in order of first appearance, equal keys keep their relative order
+        void sort()
+        {
+            permute_in_place( this->begin(), this->sorter::rank_order( this->begin(), this->end(), std::identity{} ) );
+        }
+    }; // struct topological_sort_span
+
     //
     // Sequence containers
     // std::array
@@ -342,14 +3858,15 @@ namespace snicholls {
 
     template<
         class T,
-        std::size_t N
+        std::size_t N,
+        class Traits = default_sorter_traits<T>
     > struct topological_sort_array  :
         std::array<T, N>,
-        topological_sorter< T >
+        topological_sorter< T, Traits >
     {
         // Adapter types
         using container = std::array< T, N>;
-        using sorter    = topological_sorter< T >;
+        using sorter    = topological_sorter< T, Traits >;
         using sort_type = typename sorter::template array_sort_type<T, N>;
         using visited_type = typename sorter::visited_type;
         
@@ -373,40 +3890,200 @@ namespace snicholls {
         // Destructor
         ~topological_sort_array() {};
         
+        // As for topological_sort_vector - the topological order is cached until the next precede
         sort_type sort()
         {
-            // Do the topological sort
-            auto s = this->sorter::topological_sort();
+            auto order = this->sorter::rank_order( this->begin(), this->end(), std::identity{} );
             
-            // Now return our ordered array
             sort_type result;
-            // Has this particular key been copied to the result ?
-            visited_type copied;
-            
-            // First copy in the elements from the topological sort using stack helper
-            std::size_t index{0};
-            stack_helper( s,
-                         [&](const auto key) {
-                        // Make sure that our result is the same length - if key occurs n times, insert it n times - if a key does not occur at all - ignore it
-                        auto n = std::count( this->begin(), this->end(), key );
-                        for (auto i{0};i<n;++i) result[index++] = key;
-                        copied[key] = true;
-                        } );
+            for ( std::size_t i{0}; i < N; ++i ) result[i] = (*this)[ order[i] ];
+            return result;
+        }
+        
+#if SNICHOLLS_TOPOLOGICAL_EXECUTION
+        // eg g.sort( std::execution::par_unseq ) - the rank lookups and the copy into the result run under the policy
+        template <typename ExecutionPolicy>
+            requires std::is_execution_policy_v< std::remove_cvref_t<ExecutionPolicy> >
+        sort_type sort( ExecutionPolicy&& policy )
+        {
+            auto order = this->sorter::rank_order( policy, this->begin(), this->end(), std::identity{} );
             
-            // Now copy the rest make sure that we haven't missed anything
-            // By defintion - we put these last since putting them first may violate other topological constraints - eg sort is called before precede...
-            for (const auto& key : *this )
+            sort_type result;
+            std::transform( policy, order.begin(), order.end(), result.begin(), [&](auto i) { return (*this)[i]; } );
+            return result;
+        }
+#endif
+    }; // topological_sort_array
+
+    //
+    // Lazy view over any forward range in topological order - no container to inherit from, nothing materialised
+    // eg for ( const auto& x : rng | snicholls::views::topological( g ) ) ...
+    // On first begin() the ranks are computed once and each element is chained onto the bucket of its key's rank - O(N + V + E)
+    // After that the elements are yielded bucket by bucket as they are consumed - stopping early costs nothing more
+    // Keys that are not in the DAG go last, in order of first appearance, equal keys keep their relative order
+    // The sorter is held by reference and must outlive the view
+    //
+
+    template <std::ranges::forward_range V, typename Sorter, typename Proj = std::identity>
+        requires std::ranges::view<V>
+    class topological_view : public std::ranges::view_interface< topological_view<V, Sorter, Proj> >
+    {
+        static constexpr std::uint32_t npos = ~std::uint32_t{0};
+        
+        // Built on first begin() - not copied with the view
+        struct cache
+        {
+            std::vector< std::ranges::iterator_t<V> > elements;
+            std::vector< std::uint32_t > next;  // next element of the same bucket
+            std::vector< std::uint32_t > head;  // first element of each bucket
+        };
+        
+    public:
+        class iterator
+        {
+        public:
+            using value_type        = std::ranges::range_value_t<V>;
+            using reference         = std::ranges::range_reference_t<V>;
+            using difference_type   = std::ptrdiff_t;
+            using iterator_concept  = std::forward_iterator_tag;
+            
+            iterator() = default;
+            iterator( const cache* c, std::size_t bucket, std::uint32_t element ) : c( c ), bucket( bucket ), element( element ) {};
+            
+            reference operator*() const { return *c->elements[element]; }
+            auto operator->() const requires std::is_reference_v<reference> { return std::addressof( **this ); }
+            
+            iterator& operator++()
+            {
+                element = c->next[element];
+                // End of this bucket - move on to the next bucket that has anything in it
+                while ( element == npos && ++bucket < c->head.size() )
+                    element = c->head[bucket];
+                return *this;
+            }
+            
+            iterator operator++(int) { auto it = *this; ++*this; return it; }
+            
+            bool operator==( const iterator& other ) const { return element == other.element; }
+            bool operator==( std::default_sentinel_t ) const { return element == npos; }
+            
+        private:
+            const cache*    c{ nullptr };
+            std::size_t     bucket{ 0 };
+            std::uint32_t   element{ npos };
+        };
+        
+        topological_view() = default;
+        topological_view( V base, Sorter& g, Proj proj = {} ) : base_( std::move(base) ), g( &g ), proj( std::move(proj) ) {};
+        
+        topological_view( const topological_view& other ) : base_( other.base_ ), g( other.g ), proj( other.proj ) {};
+        topological_view( topological_view&& ) = default;
+        
+        topological_view& operator=( const topological_view& other )
+        {
+            base_ = other.base_;
+            g = other.g;
+            proj = other.proj;
+            c.reset();
+            return *this;
+        }
+        topological_view& operator=( topological_view&& ) = default;
+        
+        V base() const { return base_; }
+        
+        iterator begin()
+        {
+            if ( !c ) build();
+            
+            std::size_t bucket{0};
+            while ( bucket < c->head.size() && c->head[bucket] == npos ) ++bucket;
+            return bucket < c->head.size() ? iterator{ &*c, bucket, c->head[bucket] } : iterator{};
+        }
+        
+        std::default_sentinel_t end() const { return {}; }
+        
+    private:
+        void build()
+        {
+            const auto& dag = g->ordered();
+            auto next_rank = dag.size();
+            auto unranked = g->template make_map< typename Sorter::rank_type >();
+            
+            c.emplace();
+            c->head.assign( next_rank, npos );
+            std::vector< std::uint32_t > tail( next_rank, npos );
+            
+            for ( auto it = std::ranges::begin(base_); it != std::ranges::end(base_); ++it )
             {
-                if ( copied[key] == false )
+                // Views such as iota and transform yield prvalues - hold the element while key may refer into it
+                auto&& elem = *it;
+                const auto& key = std::invoke( proj, elem );
+                std::size_t r = dag.rank( key );
+                if ( r == dag.npos )
                 {
-                    copied[key] = true;
-                    auto n = std::count( this->begin(), this->end(), key );
-                    for (auto i{0};i<n;++i) result[index++] = key;
+                    auto [pos, inserted] = unranked.try_emplace( key, next_rank );
+                    if ( inserted )
+                    {
+                        ++next_rank;
+                        c->head.push_back( npos );
+                        tail.push_back( npos );
+                    }
+                    r = pos->second;
                 }
+                
+                // Append to the tail of the bucket - keeps equal keys in order
+                const auto i = static_cast< std::uint32_t >( c->elements.size() );
+                c->elements.push_back( it );
+                c->next.push_back( npos );
+                if ( tail[r] == npos ) c->head[r] = i; else c->next[ tail[r] ] = i;
+                tail[r] = i;
             }
-            return result;
         }
-    }; // topological_sort_array
+        
+        V base_{};
+        Sorter* g{ nullptr };
+        [[no_unique_address]] Proj proj{};
+        std::optional< cache > c;
+    };
+
+    namespace views {
+    
+        // The right hand side of rng | views::topological( g )
+        template <typename Sorter, typename Proj>
+        struct topological_closure
+        {
+            Sorter* g;
+            Proj proj;
+            
+            template <std::ranges::viewable_range R>
+                requires std::ranges::forward_range<R>
+            friend auto operator|( R&& r, topological_closure c )
+            {
+                return topological_view< std::views::all_t<R>, Sorter, Proj >( std::views::all( std::forward<R>(r) ), *c.g, std::move(c.proj) );
+            }
+        };
+    
+        struct topological_fn
+        {
+            // views::topological( g ) or views::topological( g, proj ) - g is any topological_sorter, adapters included
+            template <typename Key, typename Traits, typename Proj = std::identity>
+            auto operator()( topological_sorter<Key, Traits>& g, Proj proj = {} ) const
+            {
+                return topological_closure< topological_sorter<Key, Traits>, Proj >{ &g, std::move(proj) };
+            }
+            
+            // views::topological( rng, g ) or views::topological( rng, g, proj )
+            template <std::ranges::viewable_range R, typename Key, typename Traits, typename Proj = std::identity>
+                requires std::ranges::forward_range<R>
+            auto operator()( R&& r, topological_sorter<Key, Traits>& g, Proj proj = {} ) const
+            {
+                return std::forward<R>(r) | (*this)( g, std::move(proj) );
+            }
+        };
+    
+        inline constexpr topological_fn topological{};
+    
+    } // namespace views
 } // namespace snicholls
 
 #endif /* stl_topological_sorter_hpp */